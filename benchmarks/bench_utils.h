@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <string>
+#include <sys/resource.h>
+
+namespace bench {
+
+    using Clock = std::chrono::steady_clock;
+
+    template <typename Function>
+    double MeasureMilliseconds(Function function) {
+        const auto start = Clock::now();
+        function();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // heap bytes in use, so that the size of a structure is the difference before and after it is built
+    inline size_t GetHeapBytes() {
+        const struct mallinfo2 info = mallinfo2();
+        return info.uordblks + info.hblkhd;
+    }
+
+    inline size_t GetPeakResidentBytes() {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+    }
+
+    inline double ToMegabytes(size_t bytes) {
+        return static_cast<double>(bytes) / (1024 * 1024);
+    }
+
+    // prints "name: value unit" lines, aligned
+    inline void Report(const std::string& name, double value, const std::string& unit) {
+        std::cout << "  " << std::left << std::setw(40) << name << std::right << std::setw(12)
+            << std::fixed << std::setprecision(3) << value << ' ' << unit << '\n';
+    }
+
+}  // namespace bench
@@ -0,0 +1,186 @@
+﻿#pragma once
+
+#include "geo.h"
+#include "json.h"
+#include "transport_catalogue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// synthetic cities for the benchmarks: the stops lie on a square grid, every bus walks between neighbouring
+// stops, turning at random, and the road between two stops is up to 1.4 times longer than the straight line.
+// The same options and seed always give the same city
+namespace city_generator {
+
+    using namespace std::literals;
+
+    struct Options {
+        size_t side = 25;          // the grid has side * side stops
+        size_t bus_count = 150;
+        size_t route_length = 20;  // at most, a walk also ends early when it is stuck
+        bool long_names = false;   // about 35 characters, longer than the small-string buffer
+        uint32_t seed = 1;
+    };
+
+    struct City {
+        struct Stop {
+            std::string name;
+            geo::Coordinates coordinates;
+            std::map<size_t, int> road_distances; // by the stop index
+        };
+
+        struct Bus {
+            std::string name;
+            std::vector<size_t> stops; // as in base_requests: a roundtrip ends at its first stop
+            bool is_roundtrip;
+        };
+
+        std::vector<Stop> stops;
+        std::vector<Bus> buses;
+    };
+
+    inline City MakeCity(const Options& options) {
+        std::mt19937 random(options.seed);
+        const auto chance = [&random](double probability) {
+            return std::uniform_real_distribution<double>(0.0, 1.0)(random) < probability;
+        };
+        const auto position = [&random, &options]() {
+            return std::uniform_int_distribution<int>(0, static_cast<int>(options.side) - 1)(random);
+        };
+        const std::pair<int, int> directions[] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+        const auto direction = [&]() {
+            return directions[std::uniform_int_distribution<int>(0, 3)(random)];
+        };
+
+        City city;
+        const int side = static_cast<int>(options.side);
+        for (int x = 0; x < side; ++x) {
+            for (int y = 0; y < side; ++y) {
+                const std::string coordinates = std::to_string(x) + '_' + std::to_string(y);
+                city.stops.push_back({ (options.long_names ? "Generated city stop at the corner "
+                    : "Stop ") + coordinates, { 55.6 + x * 0.004, 37.5 + y * 0.006 }, {} });
+            }
+        }
+        const auto add_road = [&](size_t from, size_t to) {
+            if (city.stops[to].road_distances.count(from) || city.stops[from].road_distances.count(to)) {
+                return;
+            }
+            const double length = geo::ComputeHaversineDistance(city.stops[from].coordinates, city.stops[to].coordinates)
+                * std::uniform_real_distribution<double>(1.0, 1.4)(random);
+            city.stops[from].road_distances[to] = static_cast<int>(std::ceil(length)) + 1;
+        };
+
+        for (size_t bus = 0; bus < options.bus_count; ++bus) {
+            int x = position();
+            int y = position();
+            std::vector<size_t> stops{ static_cast<size_t>(x * side + y) };
+            auto [dx, dy] = direction();
+            while (stops.size() < options.route_length) {
+                if (chance(0.3)) {
+                    std::tie(dx, dy) = direction();
+                }
+                const int next_x = x + dx;
+                const int next_y = y + dy;
+                const size_t next = static_cast<size_t>(next_x * side + next_y);
+                if (next_x < 0 || next_x >= side || next_y < 0 || next_y >= side
+                    || std::find(stops.begin(), stops.end(), next) != stops.end()) {
+                    std::tie(dx, dy) = direction();
+                    if (chance(0.1)) {
+                        break;
+                    }
+                    continue;
+                }
+                x = next_x;
+                y = next_y;
+                stops.push_back(next);
+            }
+            if (stops.size() < 2) {
+                continue;
+            }
+            const bool is_roundtrip = chance(0.4);
+            if (is_roundtrip) {
+                stops.push_back(stops.front());
+            }
+            for (size_t i = 0; i + 1 < stops.size(); ++i) {
+                add_road(stops[i], stops[i + 1]);
+            }
+            city.buses.push_back({ "Bus " + std::to_string(bus), std::move(stops), is_roundtrip });
+        }
+        return city;
+    }
+
+    inline json::Array MakeBaseRequests(const City& city) {
+        json::Array requests;
+        for (const City::Stop& stop : city.stops) {
+            json::Dict road_distances;
+            for (const auto& [to, distance] : stop.road_distances) {
+                road_distances.emplace(city.stops[to].name, distance);
+            }
+            requests.push_back(json::Dict{
+                { "type", "Stop"s }, { "name", stop.name },
+                { "latitude", stop.coordinates.lat }, { "longitude", stop.coordinates.lng },
+                { "road_distances", std::move(road_distances) } });
+        }
+        for (const City::Bus& bus : city.buses) {
+            json::Array stops;
+            for (const size_t stop : bus.stops) {
+                stops.push_back(city.stops[stop].name);
+            }
+            requests.push_back(json::Dict{
+                { "type", "Bus"s }, { "name", bus.name }, { "stops", std::move(stops) }, { "is_roundtrip", bus.is_roundtrip } });
+        }
+        return requests;
+    }
+
+    // the catalogue that JsonReader makes from the base requests of the city, without the JSON
+    inline void FillCatalogue(const City& city, transport_catalogue::TransportCatalogue& catalogue) {
+        for (const City::Stop& stop : city.stops) {
+            catalogue.AddStop(stop.name, stop.coordinates);
+        }
+        for (size_t from = 0; from < city.stops.size(); ++from) {
+            for (const auto& [to, distance] : city.stops[from].road_distances) {
+                catalogue.AddDistance(static_cast<transport_catalogue::StopId>(from),
+                    static_cast<transport_catalogue::StopId>(to), distance);
+            }
+        }
+        for (const City::Bus& bus : city.buses) {
+            std::vector<transport_catalogue::StopId> route(bus.stops.begin(), bus.stops.end());
+            if (!bus.is_roundtrip) {
+                route.insert(route.end(), std::next(bus.stops.rbegin()), bus.stops.rend());
+            }
+            catalogue.AddBus(bus.name, route, bus.is_roundtrip);
+        }
+    }
+
+    // "Route" stat requests between random stops
+    inline json::Array MakeRouteRequests(const City& city, size_t count, uint32_t seed) {
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<size_t> stop(0, city.stops.size() - 1);
+        json::Array requests;
+        for (size_t id = 0; id < count; ++id) {
+            const size_t from = stop(random);
+            const size_t to = stop(random);
+            requests.push_back(json::Dict{ { "id", static_cast<int>(id) }, { "type", "Route"s },
+                { "from", city.stops[from].name }, { "to", city.stops[to].name } });
+        }
+        return requests;
+    }
+
+    inline json::Dict MakeRenderSettings() {
+        return json::Dict{
+            { "width", 1200.0 }, { "height", 1200.0 }, { "padding", 50.0 }, { "line_width", 14.0 }, { "stop_radius", 5.0 },
+            { "bus_label_font_size", 20 }, { "bus_label_offset", json::Array{ 7.0, 15.0 } },
+            { "stop_label_font_size", 20 }, { "stop_label_offset", json::Array{ 7.0, -3.0 } },
+            { "underlayer_color", json::Array{ 255, 255, 255, 0.85 } }, { "underlayer_width", 3.0 },
+            { "color_palette", json::Array{ "green"s, json::Array{ 255, 160, 0 }, "red"s } } };
+    }
+
+}  // namespace city_generator
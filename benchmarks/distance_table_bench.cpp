@@ -0,0 +1,132 @@
+﻿// DistanceTable against the unordered_map of stop pairs it replaced, which had the p1 * 17 + p2 * 23 hash and
+// looked a distance up forward and then in the reverse direction. Random distances between random stops,
+// lookups of the added pairs, half of them reversed, and of pairs that were never added. Single runs.
+// Also checks that both give the same distance, or none, for every lookup, and that ForEach gives back
+// exactly the distances the map holds.
+// Build from this directory:
+//   g++ -std=c++20 -O2 -pthread -I../transport-catalogue distance_table_bench.cpp -o distance_table_bench
+// Usage: distance_table_bench [distance_count] [stop_count] [lookup_count]
+
+#include "bench_utils.h"
+
+#include "distance_table.h"
+#include "domain.h"
+
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    using transport_catalogue::StopId;
+    using StopPair = std::pair<StopId, StopId>;
+
+    // the hasher of the former TransportCatalogue::distances_
+    struct PairHasher {
+        size_t operator()(const StopPair& pair) const {
+            return static_cast<size_t>(pair.first) * 17 + static_cast<size_t>(pair.second) * 23;
+        }
+    };
+
+    using DistanceMap = std::unordered_map<StopPair, int, PairHasher>;
+
+    // the former GetDistance, std::nullopt where at() threw
+    std::optional<int> FindInMap(const DistanceMap& distances, StopId from, StopId to) {
+        if (const auto it = distances.find({ from, to }); it != distances.end()) {
+            return it->second;
+        }
+        if (const auto it = distances.find({ to, from }); it != distances.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t distance_count = argc > 1 ? std::stoul(argv[1]) : 1'000'000;
+    const StopId stop_count = argc > 2 ? static_cast<StopId>(std::stoul(argv[2])) : 100'000;
+    const size_t lookup_count = argc > 3 ? std::stoul(argv[3]) : 10'000'000;
+
+    std::mt19937 random(5);
+    std::uniform_int_distribution<StopId> stop(0, stop_count - 1);
+    std::uniform_int_distribution<int> distance(1, 100'000);
+    std::vector<std::pair<StopPair, int>> distances;
+    for (size_t i = 0; i < distance_count; ++i) {
+        const StopPair pair{ stop(random), stop(random) };
+        distances.push_back({ pair, distance(random) });
+        // some pairs get the other direction too, with its own distance
+        if (i % 10 == 0) {
+            distances.push_back({ { pair.second, pair.first }, distance(random) });
+        }
+    }
+    // three quarters are added pairs, half of those reversed, the rest are random and mostly not added
+    std::vector<StopPair> lookups;
+    for (size_t i = 0; i < lookup_count; ++i) {
+        const StopPair pair = i % 4 == 3 ? StopPair{ stop(random), stop(random) } : distances[random() % distances.size()].first;
+        lookups.push_back(i % 2 == 0 ? pair : StopPair{ pair.second, pair.first });
+    }
+    std::cout << distances.size() << " distances over " << stop_count << " stops, " << lookups.size() << " lookups\n";
+
+    size_t heap_before = bench::GetHeapBytes();
+    DistanceMap map;
+    const double map_build_time = bench::MeasureMilliseconds([&]() {
+        for (const auto& [pair, value] : distances) {
+            map[pair] = value;
+        }
+    });
+    const size_t map_size = bench::GetHeapBytes() - heap_before;
+
+    heap_before = bench::GetHeapBytes();
+    transport_catalogue::DistanceTable table;
+    const double table_build_time = bench::MeasureMilliseconds([&]() {
+        for (const auto& [pair, value] : distances) {
+            table.Add(pair.first, pair.second, value);
+        }
+    });
+    const size_t table_size = bench::GetHeapBytes() - heap_before;
+
+    std::vector<std::optional<int>> map_results;
+    std::vector<std::optional<int>> table_results;
+    map_results.reserve(lookups.size());
+    table_results.reserve(lookups.size());
+    const double map_lookup_time = bench::MeasureMilliseconds([&]() {
+        for (const auto& [from, to] : lookups) {
+            map_results.push_back(FindInMap(map, from, to));
+        }
+    });
+    const double table_lookup_time = bench::MeasureMilliseconds([&]() {
+        for (const auto& [from, to] : lookups) {
+            table_results.push_back(table.Find(from, to));
+        }
+    });
+
+    const auto report = [&lookups](const std::string& name, double build_time, size_t size, double lookup_time) {
+        std::cout << name << '\n';
+        bench::Report("build", build_time, "ms");
+        bench::Report("memory", bench::ToMegabytes(size), "MB");
+        bench::Report("lookup", lookup_time * 1'000'000 / lookups.size(), "ns");
+    };
+    report("unordered_map, forward then reverse lookup"s, map_build_time, map_size, map_lookup_time);
+    report("DistanceTable"s, table_build_time, table_size, table_lookup_time);
+
+    size_t lookup_mismatch_count = 0;
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        lookup_mismatch_count += map_results[i] != table_results[i];
+    }
+    std::map<StopPair, int> given;
+    table.ForEach([&given](StopId from, StopId to, int value) {
+        given[{ from, to }] = value;
+    });
+    const bool is_same_content = given == std::map<StopPair, int>(map.begin(), map.end());
+    std::cout << "  " << lookup_mismatch_count << " lookups differ, ForEach "
+        << (is_same_content ? "gives the map contents\n"sv : "DIFFERS FROM THE MAP CONTENTS\n"sv);
+    return lookup_mismatch_count == 0 && is_same_content ? 0 : 1;
+}
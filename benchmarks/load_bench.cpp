@@ -0,0 +1,91 @@
+﻿// allocations, time and peak RSS of loading a catalogue file and freezing the catalogue, as process_requests does.
+// The file is written by a separate run, so that the peak RSS of the load run is that of the load alone.
+// Build from this directory:
+//   g++ -std=c++20 -O2 -pthread -I../transport-catalogue load_bench.cpp $(ls ../transport-catalogue/*.cpp | grep -v main.cpp) -o load_bench
+// Usage:
+//   load_bench make <file> [side] [bus_count] [route_length] [long]   writes the catalogue of a generated city,
+//                                                                     "long" gives the stops ~35-character names
+//   load_bench load <file>                                            loads and freezes it
+
+#include "bench_utils.h"
+#include "city_generator.h"
+
+#include "catalogue_file.h"
+#include "transport_catalogue.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+using namespace std::literals;
+
+namespace {
+
+    std::atomic<size_t> allocation_count = 0;
+
+}  // namespace
+
+// counts the allocations of the program, the nothrow forms of new call this one as well
+void* operator new(size_t size) {
+    ++allocation_count;
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: load_bench make|load <file> [side] [bus_count] [route_length] [long]\n"sv;
+        return 1;
+    }
+    const std::string mode = argv[1];
+    const std::string path = argv[2];
+
+    if (mode == "make"s) {
+        city_generator::Options options;
+        if (argc > 3) {
+            options.side = std::stoul(argv[3]);
+        }
+        if (argc > 4) {
+            options.bus_count = std::stoul(argv[4]);
+        }
+        if (argc > 5) {
+            options.route_length = std::stoul(argv[5]);
+        }
+        options.long_names = argc > 6 && argv[6] == "long"s;
+        transport_catalogue::TransportCatalogue catalogue;
+        city_generator::FillCatalogue(city_generator::MakeCity(options), catalogue);
+        catalogue_file::SaveCatalogue(path, catalogue, json::Dict{}, 0);
+        std::cout << "saved " << options.side * options.side << " stops\n";
+        return 0;
+    }
+    if (mode != "load"s) {
+        std::cerr << "Unknown mode "sv << mode << '\n';
+        return 1;
+    }
+
+    const size_t allocations_before = allocation_count;
+    const size_t resident_before = bench::GetPeakResidentBytes();
+    size_t stop_count = 0;
+    const double load_time = bench::MeasureMilliseconds([&]() {
+        catalogue_file::LoadedCatalogue loaded = catalogue_file::LoadCatalogue(path);
+        loaded.catalogue.Freeze();
+        stop_count = loaded.catalogue.GetStopCount();
+    });
+    std::cout << stop_count << " stops, load and Freeze\n";
+    bench::Report("allocations", static_cast<double>(allocation_count - allocations_before), "");
+    bench::Report("time", load_time, "ms");
+    bench::Report("peak RSS", bench::ToMegabytes(bench::GetPeakResidentBytes()), "MB");
+    bench::Report("peak RSS growth", bench::ToMegabytes(bench::GetPeakResidentBytes() - resident_before), "MB");
+}
@@ -0,0 +1,129 @@
+﻿// the Matrix request against the Route requests for the same stop pairs, answered by JsonReader on a generated
+// city, and whether every Matrix cell equals the total_time of its Route response. Single runs.
+// Build from this directory:
+//   g++ -std=c++20 -O2 -pthread -I../transport-catalogue matrix_bench.cpp $(ls ../transport-catalogue/*.cpp | grep -v main.cpp) -o matrix_bench
+// Usage: matrix_bench [router] [stop_count] [side] [bus_count] [route_length]
+//   router      as in routing_settings, dijkstra by default
+//   stop_count  sources and targets of the matrix, 50 by default: stop_count^2 Route requests
+
+#include "bench_utils.h"
+#include "city_generator.h"
+
+#include "json.h"
+#include "json_reader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    json::Dict MakeDocument(const city_generator::City& city, const std::string& router, json::Array stat_requests) {
+        return json::Dict{
+            { "base_requests", city_generator::MakeBaseRequests(city) },
+            { "render_settings", city_generator::MakeRenderSettings() },
+            { "routing_settings", json::Dict{ { "bus_wait_time", 4 }, { "bus_velocity", 30.0 }, { "router", router } } },
+            { "stat_requests", std::move(stat_requests) } };
+    }
+
+    // runs the whole input through JsonReader, as the program does, and returns the output
+    std::string Answer(const json::Dict& document, double& time) {
+        std::ostringstream input_text;
+        json::Print(json::Document(json::Node(document)), input_text);
+        std::istringstream input(input_text.str());
+        std::ostringstream output;
+        time = bench::MeasureMilliseconds([&]() {
+            JsonReader reader(input);
+            reader.PrintToStream(output);
+        });
+        return output.str();
+    }
+
+    // distinct random stop names
+    std::vector<std::string> PickStops(const city_generator::City& city, size_t count) {
+        std::vector<size_t> indices(city.stops.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            indices[i] = i;
+        }
+        std::shuffle(indices.begin(), indices.end(), std::mt19937(3));
+        std::vector<std::string> names;
+        for (size_t i = 0; i < std::min(count, indices.size()); ++i) {
+            names.push_back(city.stops[indices[i]].name);
+        }
+        return names;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const std::string router = argc > 1 ? argv[1] : "dijkstra"s;
+    const size_t stop_count = argc > 2 ? std::stoul(argv[2]) : 50;
+    city_generator::Options options;
+    if (argc > 3) {
+        options.side = std::stoul(argv[3]);
+    }
+    if (argc > 4) {
+        options.bus_count = std::stoul(argv[4]);
+    }
+    if (argc > 5) {
+        options.route_length = std::stoul(argv[5]);
+    }
+    const city_generator::City city = city_generator::MakeCity(options);
+    const std::vector<std::string> stops = PickStops(city, stop_count);
+
+    json::Array stop_nodes(stops.begin(), stops.end());
+    json::Array matrix_requests{ json::Dict{ { "id", 0 }, { "type", "Matrix"s }, { "from", stop_nodes }, { "to", stop_nodes } } };
+    json::Array route_requests;
+    for (const std::string& from : stops) {
+        for (const std::string& to : stops) {
+            route_requests.push_back(json::Dict{ { "id", static_cast<int>(route_requests.size()) }, { "type", "Route"s },
+                { "from", from }, { "to", to } });
+        }
+    }
+
+    double empty_time = 0.0;
+    double matrix_time = 0.0;
+    double routes_time = 0.0;
+    Answer(MakeDocument(city, router, {}), empty_time);
+    const std::string matrix_output = Answer(MakeDocument(city, router, std::move(matrix_requests)), matrix_time);
+    const std::string routes_output = Answer(MakeDocument(city, router, std::move(route_requests)), routes_time);
+
+    std::cout << city.stops.size() << " stops, " << router << " router, " << stops.size() << 'x' << stops.size() << '\n';
+    bench::Report("no stat requests (parsing and build)", empty_time, "ms");
+    bench::Report("Matrix request", matrix_time, "ms");
+    bench::Report("Route requests", routes_time, "ms");
+    bench::Report("Matrix, over the build", matrix_time - empty_time, "ms");
+    bench::Report("Route requests, over the build", routes_time - empty_time, "ms");
+
+    std::istringstream matrix_stream(matrix_output);
+    std::istringstream routes_stream(routes_output);
+    const json::Document matrix_document = json::Load(matrix_stream);
+    const json::Document routes_document = json::Load(routes_stream);
+    const json::Array& times = matrix_document.GetRoot().AsArray().front().AsDict().at("times"s).AsArray();
+    const json::Array& responses = routes_document.GetRoot().AsArray();
+    size_t mismatch_count = 0;
+    double max_difference = 0.0;
+    for (size_t row = 0; row < stops.size(); ++row) {
+        for (size_t column = 0; column < stops.size(); ++column) {
+            const json::Node& cell = times[row].AsArray()[column];
+            const json::Dict& response = responses[row * stops.size() + column].AsDict();
+            const auto total_time = response.find("total_time"s);
+            if (cell.IsNull() != (total_time == response.end())) {
+                ++mismatch_count;
+            }
+            else if (!cell.IsNull() && cell.AsDouble() != total_time->second.AsDouble()) {
+                ++mismatch_count;
+                max_difference = std::max(max_difference, std::abs(cell.AsDouble() - total_time->second.AsDouble()));
+            }
+        }
+    }
+    std::cout << "  " << mismatch_count << " of " << stops.size() * stops.size()
+        << " cells differ from total_time, by at most " << max_difference << " min\n";
+}
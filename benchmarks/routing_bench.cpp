@@ -0,0 +1,284 @@
+﻿// benchmarks of the routing engines on a generated city, single runs, so repeat them on a busy machine.
+// Build from this directory:
+//   g++ -std=c++20 -O2 -pthread -I../transport-catalogue routing_bench.cpp $(ls ../transport-catalogue/*.cpp | grep -v main.cpp) -o routing_bench
+// Usage: routing_bench <section> [side] [bus_count] [route_length]
+//   engines  preprocessing time, memory and query latency of the all-pairs table, Dijkstra
+//            and contraction hierarchies
+//   table    bytes per vertex pair of the all-pairs table: the former vector of rows of
+//            optional<RouteInternalData>, and the flat double and float arrays
+//   threads  build time of the all-pairs table with 1, 2, 4 and 8 threads, checking that the tables are the same
+//   graph    heap of the graph with incidence lists and after Freeze, and the time of a plain Dijkstra search
+//            reading GetIncidentEdges and GetEdge against one reading GetOutgoingArcs
+//   file     load time of the route file: the graph and the row checksums that LoadRoutes reads,
+//            and the check of one row and of all rows; the file was just written, its pages are cached
+
+#include "bench_utils.h"
+#include "city_generator.h"
+
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
+#include "route_file.h"
+#include "router.h"
+#include "transport_router.h"
+
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    using Graph = graph::DirectedWeightedGraph<double>;
+    using Queries = std::vector<std::pair<graph::VertexId, graph::VertexId>>;
+
+    // arrival vertices of random stops
+    Queries MakeQueries(const Graph& graph, size_t count) {
+        std::mt19937 random(7);
+        std::uniform_int_distribution<graph::VertexId> stop(0, graph.GetVertexCount() / 2 - 1);
+        Queries queries;
+        for (size_t i = 0; i < count; ++i) {
+            queries.emplace_back(stop(random) * 2, stop(random) * 2);
+        }
+        return queries;
+    }
+
+    // builds the router with make_router and runs the queries on it
+    template <typename MakeRouter>
+    void MeasureEngine(const std::string& name, const Queries& queries, MakeRouter make_router) {
+        const size_t heap_before = bench::GetHeapBytes();
+        std::unique_ptr<graph::RouterBase<double>> router;
+        const double build_time = bench::MeasureMilliseconds([&]() {
+            router = make_router();
+        });
+        const size_t heap_size = bench::GetHeapBytes() - heap_before;
+
+        size_t found = 0;
+        const double query_time = bench::MeasureMilliseconds([&]() {
+            for (const auto& [from, to] : queries) {
+                found += router->BuildRoute(from, to).has_value();
+            }
+        });
+        std::cout << name << " (" << found << " of " << queries.size() << " routes found)\n";
+        bench::Report("preprocessing", build_time, "ms");
+        bench::Report("memory", bench::ToMegabytes(heap_size), "MB");
+        bench::Report("query", query_time * 1000 / queries.size(), "us");
+    }
+
+    void CompareEngines(const Graph& graph) {
+        const Queries queries = MakeQueries(graph, 1000);
+        MeasureEngine("all-pairs table (Floyd-Warshall)"s, queries, [&graph]() {
+            return std::make_unique<graph::Router<double>>(graph);
+        });
+        MeasureEngine("Dijkstra"s, queries, [&graph]() {
+            return std::make_unique<graph::DijkstraRouter<double>>(graph);
+        });
+        MeasureEngine("contraction hierarchies"s, queries, [&graph]() {
+            return std::make_unique<graph::ContractionHierarchy<double>>(graph);
+        });
+    }
+
+    // heap taken by the table layout used before the flat arrays, allocated the same way
+    size_t MeasureRowTableSize(size_t vertex_count) {
+        struct RouteInternalData {
+            double weight;
+            std::optional<graph::EdgeId> prev_edge;
+        };
+        const size_t heap_before = bench::GetHeapBytes();
+        const std::vector<std::vector<std::optional<RouteInternalData>>> table(vertex_count,
+            std::vector<std::optional<RouteInternalData>>(vertex_count));
+        return bench::GetHeapBytes() - heap_before;
+    }
+
+    void CompareTableLayouts(const Graph& graph) {
+        const double pair_count = static_cast<double>(graph.GetVertexCount()) * graph.GetVertexCount();
+        const auto report = [pair_count](const std::string& name, size_t size) {
+            std::cout << name << '\n';
+            bench::Report("table", bench::ToMegabytes(size), "MB");
+            bench::Report("per vertex pair", size / pair_count, "bytes");
+        };
+        report("rows of optional<RouteInternalData> (before)"s, MeasureRowTableSize(graph.GetVertexCount()));
+        report("flat arrays, double weights"s, graph::Router<double>(graph).GetTableSize());
+        report("flat arrays, float weights"s, graph::Router<double, float>(graph).GetTableSize());
+    }
+
+    void CompareThreadCounts(const Graph& graph) {
+        const size_t cell_count = graph.GetVertexCount() * graph.GetVertexCount();
+        std::unique_ptr<graph::Router<double>> serial_router;
+        double serial_time = 0.0;
+        for (const size_t thread_count : { 1, 2, 4, 8 }) {
+            std::unique_ptr<graph::Router<double>> router;
+            const double build_time = bench::MeasureMilliseconds([&]() {
+                router = std::make_unique<graph::Router<double>>(graph, thread_count);
+            });
+            std::cout << thread_count << (thread_count == 1 ? " thread\n"sv : " threads\n"sv);
+            bench::Report("build", build_time, "ms");
+            if (!serial_router) {
+                serial_router = std::move(router);
+                serial_time = build_time;
+                continue;
+            }
+            bench::Report("speedup", serial_time / build_time, "x");
+            const bool is_same = std::memcmp(router->GetTableWeights(), serial_router->GetTableWeights(),
+                cell_count * sizeof(double)) == 0
+                && std::memcmp(router->GetTablePrevEdges(), serial_router->GetTablePrevEdges(),
+                    cell_count * sizeof(uint32_t)) == 0;
+            std::cout << (is_same ? "  the same table as with 1 thread\n"sv : "  THE TABLE DIFFERS FROM THE ONE OF 1 THREAD\n"sv);
+        }
+    }
+
+    // weight of the shortest route by a Dijkstra search, for_each_edge(vertex, callback) calls callback(to, weight)
+    // for the edges leaving the vertex
+    template <typename ForEachEdge>
+    double FindRouteWeight(size_t vertex_count, graph::VertexId from, graph::VertexId to, ForEachEdge for_each_edge) {
+        using Entry = std::pair<double, graph::VertexId>;
+        std::vector<double> distances(vertex_count, std::numeric_limits<double>::infinity());
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        distances[from] = 0.0;
+        queue.push({ 0.0, from });
+        while (!queue.empty()) {
+            const auto [distance, vertex] = queue.top();
+            queue.pop();
+            if (vertex == to) {
+                return distance;
+            }
+            if (distance > distances[vertex]) {
+                continue;
+            }
+            for_each_edge(vertex, [&](graph::VertexId next, double weight) {
+                if (distance + weight < distances[next]) {
+                    distances[next] = distance + weight;
+                    queue.push({ distances[next], next });
+                }
+            });
+        }
+        return distances[to];
+    }
+
+    void CompareGraphLayouts(const Graph& frozen_graph) {
+        const size_t heap_before = bench::GetHeapBytes();
+        Graph graph(frozen_graph.GetVertexCount());
+        for (graph::EdgeId edge_id = 0; edge_id < frozen_graph.GetEdgeCount(); ++edge_id) {
+            graph.AddEdge(frozen_graph.GetEdge(edge_id));
+        }
+        const size_t list_size = bench::GetHeapBytes() - heap_before;
+        std::cout << "incidence lists\n"sv;
+        bench::Report("graph", bench::ToMegabytes(list_size), "MB");
+        const Queries queries = MakeQueries(graph, 200);
+        std::vector<double> list_weights;
+        const double list_time = bench::MeasureMilliseconds([&]() {
+            for (const auto& [from, to] : queries) {
+                list_weights.push_back(FindRouteWeight(graph.GetVertexCount(), from, to, [&graph](graph::VertexId vertex, auto callback) {
+                    for (const graph::EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+                        const auto& edge = graph.GetEdge(edge_id);
+                        callback(edge.to, edge.weight);
+                    }
+                }));
+            }
+        });
+        bench::Report("query", list_time / queries.size(), "ms");
+
+        const size_t heap_unfrozen = bench::GetHeapBytes();
+        graph.Freeze();
+        std::cout << "compressed sparse rows\n"sv;
+        bench::Report("graph", bench::ToMegabytes(list_size + bench::GetHeapBytes() - heap_unfrozen), "MB");
+        std::vector<double> arc_weights;
+        const double arc_time = bench::MeasureMilliseconds([&]() {
+            for (const auto& [from, to] : queries) {
+                arc_weights.push_back(FindRouteWeight(graph.GetVertexCount(), from, to, [&graph](graph::VertexId vertex, auto callback) {
+                    const graph::OutgoingArcs<double> arcs = graph.GetOutgoingArcs(vertex);
+                    for (size_t i = 0; i < arcs.size; ++i) {
+                        callback(arcs.targets[i], arcs.weights[i]);
+                    }
+                }));
+            }
+        });
+        bench::Report("query", arc_time / queries.size(), "ms");
+        std::cout << (arc_weights == list_weights ? "  the same route weights\n"sv : "  THE ROUTE WEIGHTS DIFFER\n"sv);
+    }
+
+    void MeasureRouteFile(const Graph& graph) {
+        const std::string path = (std::filesystem::temp_directory_path() / "routing_bench_routes.bin").string();
+        {
+            const graph::Router<double> router(graph);
+            route_file::SaveRoutes(path, 1, graph, router.GetTableWeights(), sizeof(double), router.GetTablePrevEdges());
+        }
+        std::cout << "route file of " << std::filesystem::file_size(path) / (1024 * 1024) << " MB\n"sv;
+        std::optional<route_file::LoadedRoutes> routes;
+        bench::Report("load graph and row checksums", bench::MeasureMilliseconds([&]() {
+            routes = route_file::LoadRoutes(path, 1, sizeof(double));
+        }), "ms");
+        const size_t vertex_count = routes->graph.GetVertexCount();
+        const route_file::TableRowChecker rows(*routes, sizeof(double));
+        bool is_valid = true;
+        bench::Report("check one row", bench::MeasureMilliseconds([&]() {
+            is_valid = rows.CheckRow(0);
+        }), "ms");
+        bench::Report("check all rows", bench::MeasureMilliseconds([&]() {
+            for (graph::VertexId row = 1; row < vertex_count; ++row) {
+                is_valid = rows.CheckRow(row) && is_valid;
+            }
+        }), "ms");
+        std::cout << (is_valid ? "  all rows are valid\n"sv : "  DAMAGED ROWS\n"sv);
+        routes.reset();
+        std::filesystem::remove(path);
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: routing_bench <section> [side] [bus_count] [route_length]\n"sv;
+        return 1;
+    }
+    const std::string section = argv[1];
+    city_generator::Options options;
+    if (argc > 2) {
+        options.side = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        options.bus_count = std::stoul(argv[3]);
+    }
+    if (argc > 4) {
+        options.route_length = std::stoul(argv[4]);
+    }
+
+    transport_catalogue::TransportCatalogue catalogue;
+    city_generator::FillCatalogue(city_generator::MakeCity(options), catalogue);
+    catalogue.Freeze();
+    TransportRouter router;
+    router.SetVelocity(30).SetWaitTime(4).SetRouterType(RouterType::DIJKSTRA);
+    router.BuildGraph(catalogue);
+    const Graph& graph = router.GetGraph();
+    std::cout << options.side * options.side << " stops, " << graph.GetVertexCount() << " vertices, "
+        << graph.GetEdgeCount() << " edges\n";
+
+    if (section == "engines"s) {
+        CompareEngines(graph);
+    }
+    else if (section == "table"s) {
+        CompareTableLayouts(graph);
+    }
+    else if (section == "threads"s) {
+        CompareThreadCounts(graph);
+    }
+    else if (section == "graph"s) {
+        CompareGraphLayouts(graph);
+    }
+    else if (section == "file"s) {
+        MeasureRouteFile(graph);
+    }
+    else {
+        std::cerr << "Unknown section "sv << section << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,125 @@
+﻿// startup of the program from the JSON base_requests against the one from the catalogue file of make_base,
+// through JsonReader with the dijkstra router and no stat requests. Single runs.
+// Then checks the round trip: stat requests answered after make_base and process_requests must give the output
+// of the run that takes everything from one input. The process_requests input has the base_requests of another
+// city, which it must ignore, and the settings have doubles with many digits, so that the ones saved in
+// the catalogue file are compared too; the exit status is non-zero if the outputs differ.
+// Build from this directory:
+//   g++ -std=c++20 -O2 -pthread -I../transport-catalogue startup_bench.cpp $(ls ../transport-catalogue/*.cpp | grep -v main.cpp) -o startup_bench
+// Usage: startup_bench [side] [bus_count] [route_length]
+
+#include "bench_utils.h"
+#include "city_generator.h"
+
+#include "json.h"
+#include "json_reader.h"
+
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+
+using namespace std::literals;
+
+namespace {
+
+    std::string ToText(const json::Dict& document) {
+        std::ostringstream text;
+        text << std::setprecision(std::numeric_limits<double>::max_digits10);
+        json::Print(json::Document(json::Node(document)), text);
+        return text.str();
+    }
+
+    // runs the input through JsonReader as main does in the given mode, returns the output
+    std::string Run(const std::string& input_text, RunMode mode, double& time) {
+        std::istringstream input(input_text);
+        std::ostringstream output;
+        time = bench::MeasureMilliseconds([&]() {
+            JsonReader reader(input, mode);
+            if (mode == RunMode::MAKE_BASE) {
+                reader.SaveCatalogue();
+            }
+            else {
+                reader.PrintToStream(output);
+            }
+        });
+        return output.str();
+    }
+
+    json::Array MakeStatRequests(const city_generator::City& city) {
+        json::Array requests = city_generator::MakeRouteRequests(city, 200, 11);
+        for (size_t i = 0; i < 100; ++i) {
+            const int id = static_cast<int>(requests.size());
+            requests.push_back(json::Dict{ { "id", id }, { "type", "Stop"s },
+                { "name", city.stops[i * city.stops.size() / 100].name } });
+            if (i < city.buses.size()) {
+                requests.push_back(json::Dict{ { "id", id + 1 }, { "type", "Bus"s }, { "name", city.buses[i].name } });
+            }
+        }
+        requests.push_back(json::Dict{ { "id", static_cast<int>(requests.size()) }, { "type", "Map"s } });
+        return requests;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    city_generator::Options options;
+    if (argc > 1) {
+        options.side = std::stoul(argv[1]);
+    }
+    if (argc > 2) {
+        options.bus_count = std::stoul(argv[2]);
+    }
+    if (argc > 3) {
+        options.route_length = std::stoul(argv[3]);
+    }
+    const city_generator::City city = city_generator::MakeCity(options);
+    const std::string path = (std::filesystem::temp_directory_path() / "startup_bench_catalogue.db").string();
+
+    json::Dict render_settings = city_generator::MakeRenderSettings();
+    render_settings["width"s] = 1200.123456789012;
+    render_settings["padding"s] = 50.98765432109876;
+    const json::Dict routing_settings{ { "bus_wait_time", 4 }, { "bus_velocity", 27.123456789012345 }, { "router", "dijkstra"s } };
+    const json::Dict serialization_settings{ { "file", path } };
+    const json::Dict base{
+        { "base_requests", city_generator::MakeBaseRequests(city) },
+        { "render_settings", render_settings },
+        { "routing_settings", routing_settings },
+        { "serialization_settings", serialization_settings } };
+    const auto with_requests = [](json::Dict document, json::Array stat_requests) {
+        document["stat_requests"s] = std::move(stat_requests);
+        return ToText(document);
+    };
+
+    double json_time = 0.0;
+    double make_base_time = 0.0;
+    double file_time = 0.0;
+    Run(with_requests(base, {}), RunMode::DIRECT, json_time);
+    Run(ToText(base), RunMode::MAKE_BASE, make_base_time);
+    Run(with_requests(json::Dict{ { "serialization_settings", serialization_settings } }, {}), RunMode::PROCESS_REQUESTS, file_time);
+    std::cout << city.stops.size() << " stops, " << city.buses.size() << " buses, catalogue file of "
+        << std::filesystem::file_size(path) / 1024 << " KB\n";
+    bench::Report("startup from JSON", json_time, "ms");
+    bench::Report("make_base", make_base_time, "ms");
+    bench::Report("startup from the catalogue file", file_time, "ms");
+
+    double time = 0.0;
+    const json::Array stat_requests = MakeStatRequests(city);
+    const std::string direct_output = Run(with_requests(base, stat_requests), RunMode::DIRECT, time);
+    Run(ToText(base), RunMode::MAKE_BASE, time);
+    // base_requests of another city, which process_requests must ignore
+    city_generator::Options other_options = options;
+    ++other_options.seed;
+    const json::Dict other_base{
+        { "base_requests", city_generator::MakeBaseRequests(city_generator::MakeCity(other_options)) },
+        { "serialization_settings", serialization_settings } };
+    const std::string file_output = Run(with_requests(other_base, stat_requests), RunMode::PROCESS_REQUESTS, time);
+    std::filesystem::remove(path);
+    const bool is_same = direct_output == file_output;
+    std::cout << (is_same ? "  make_base + process_requests give the output of the direct run\n"sv
+        : "  MAKE_BASE + PROCESS_REQUESTS DIFFER FROM THE DIRECT RUN\n"sv);
+    return is_same ? 0 : 1;
+}
@@ -0,0 +1,392 @@
+﻿#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // answers every query with an A* search guided by lower_bound(from, to), a callable returning a weight
+    // that no route from "from" to "to" is lighter than. The bound has to be consistent:
+    // lower_bound(u, t) <= weight(u, v) + lower_bound(v, t) for every edge (u, v).
+    //
+    // The forward search applies the tie rule of DijkstraRouter, so its routes are the ones of Router.
+    // The bidirectional search runs from both ends with the average of the two bounds as the potential
+    // and stops when no route through the frontiers can be lighter than the best one met.
+    // Its routes have the shortest weight too, but of several equal ones it may return another one.
+    // The graph has to be frozen
+    template <typename Weight, typename LowerBound>
+    class AStarRouter final : public RouterBase<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using typename RouterBase<Weight>::RouteInfo;
+
+        AStarRouter(const Graph& graph, LowerBound lower_bound, bool bidirectional = false);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        size_t GetSettledVertexCount() const override {
+            return settled_count_;
+        }
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+            ? std::numeric_limits<Weight>::infinity()
+            : std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        struct QueueItem {
+            Weight key; // weight of the route plus the potential of the vertex
+            VertexId vertex;
+
+            bool operator>(const QueueItem& other) const {
+                return key > other.key || (key == other.key && vertex > other.vertex);
+            }
+        };
+
+        // one direction of the search: routes from the source, or routes to the target for the backward one
+        struct SearchSpace {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> edges;  // the edge next to the vertex on its route
+            std::vector<size_t> depths; // number of edges in the route
+            std::vector<bool> settled;
+            std::vector<VertexId> touched_vertices;
+            std::vector<QueueItem> queue;
+
+            explicit SearchSpace(size_t vertex_count);
+
+            void Reset();
+            void Push(VertexId vertex, Weight weight, Weight key, EdgeId edge, size_t depth);
+            std::optional<QueueItem> Pop();
+            Weight GetMinKey() const {
+                return queue.empty() ? INFINITE_WEIGHT : queue.front().key;
+            }
+        };
+
+        // potential of the forward search, the backward search uses the negated one
+        Weight GetPotential(VertexId vertex) const;
+
+        // bounds from the vertex to the target and from the source to the vertex, computed once per query
+        void ResetBounds() const;
+        Weight GetBoundToTarget(VertexId vertex) const;
+        Weight GetBoundFromSource(VertexId vertex) const;
+
+        std::optional<RouteInfo> RunSearch(VertexId from, VertexId to) const;
+        std::optional<RouteInfo> RunBidirectionalSearch(VertexId from, VertexId to) const;
+
+        // true if the intermediate vertices of the forward route to "candidate" are fewer
+        // than the ones of the route to "current", see DijkstraRouter
+        bool HasPreferredPath(VertexId candidate, VertexId current) const;
+
+        // edges entering the vertex, as arcs whose targets are the sources of the edges
+        OutgoingArcs<Weight> GetIncomingArcs(VertexId vertex) const;
+
+        const Graph& graph_;
+        LowerBound lower_bound_;
+        bool bidirectional_;
+
+        // the reversed graph in the compressed sparse row form, only for the bidirectional search:
+        // the edges entering a vertex v are [incoming_offsets_[v], incoming_offsets_[v + 1]), in the order of ids
+        std::vector<size_t> incoming_offsets_;
+        std::vector<VertexId> incoming_sources_;
+        std::vector<Weight> incoming_weights_;
+        std::vector<EdgeId> incoming_edges_;
+
+        mutable SearchSpace forward_search_;
+        mutable SearchSpace backward_search_;
+        mutable VertexId source_ = 0;
+        mutable VertexId target_ = 0;
+        mutable std::vector<Weight> bounds_to_target_;
+        mutable std::vector<Weight> bounds_from_source_;
+        mutable std::vector<VertexId> bounded_vertices_;
+        mutable size_t settled_count_ = 0;
+    };
+
+    template <typename Weight, typename LowerBound>
+    AStarRouter<Weight, LowerBound>::SearchSpace::SearchSpace(size_t vertex_count)
+        : weights(vertex_count, INFINITE_WEIGHT)
+        , edges(vertex_count, NO_EDGE)
+        , depths(vertex_count, 0)
+        , settled(vertex_count, false)
+    {
+    }
+
+    template <typename Weight, typename LowerBound>
+    void AStarRouter<Weight, LowerBound>::SearchSpace::Reset() {
+        for (const VertexId vertex : touched_vertices) {
+            weights[vertex] = INFINITE_WEIGHT;
+            edges[vertex] = NO_EDGE;
+            depths[vertex] = 0;
+            settled[vertex] = false;
+        }
+        touched_vertices.clear();
+        queue.clear();
+    }
+
+    template <typename Weight, typename LowerBound>
+    void AStarRouter<Weight, LowerBound>::SearchSpace::Push(VertexId vertex, Weight weight, Weight key,
+        EdgeId edge, size_t depth) {
+        if (weights[vertex] == INFINITE_WEIGHT) {
+            touched_vertices.push_back(vertex);
+        }
+        weights[vertex] = weight;
+        edges[vertex] = edge;
+        depths[vertex] = depth;
+        queue.push_back({ key, vertex });
+        std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+    }
+
+    template <typename Weight, typename LowerBound>
+    std::optional<typename AStarRouter<Weight, LowerBound>::QueueItem> AStarRouter<Weight, LowerBound>::SearchSpace::Pop() {
+        while (!queue.empty()) {
+            std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+            const QueueItem item = queue.back();
+            queue.pop_back();
+            if (!settled[item.vertex]) {
+                settled[item.vertex] = true;
+                return item;
+            }
+        }
+        return std::nullopt;
+    }
+
+    template <typename Weight, typename LowerBound>
+    AStarRouter<Weight, LowerBound>::AStarRouter(const Graph& graph, LowerBound lower_bound, bool bidirectional)
+        : graph_(graph)
+        , lower_bound_(std::move(lower_bound))
+        , bidirectional_(bidirectional)
+        , forward_search_(graph.GetVertexCount())
+        , backward_search_(bidirectional ? graph.GetVertexCount() : 0)
+        , bounds_to_target_(graph.GetVertexCount(), INFINITE_WEIGHT)
+        , bounds_from_source_(bidirectional ? graph.GetVertexCount() : 0, INFINITE_WEIGHT)
+    {
+        if (graph.HasNegativeWeights()) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        if (!bidirectional_) {
+            return;
+        }
+        incoming_offsets_.assign(graph.GetVertexCount() + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            ++incoming_offsets_[graph.GetEdge(edge_id).to + 1];
+        }
+        std::partial_sum(incoming_offsets_.begin(), incoming_offsets_.end(), incoming_offsets_.begin());
+        incoming_sources_.resize(graph.GetEdgeCount());
+        incoming_weights_.resize(graph.GetEdgeCount());
+        incoming_edges_.resize(graph.GetEdgeCount());
+        std::vector<size_t> positions(incoming_offsets_.begin(), incoming_offsets_.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            const size_t position = positions[edge.to]++;
+            incoming_sources_[position] = edge.from;
+            incoming_weights_[position] = edge.weight;
+            incoming_edges_[position] = edge_id;
+        }
+    }
+
+    template <typename Weight, typename LowerBound>
+    OutgoingArcs<Weight> AStarRouter<Weight, LowerBound>::GetIncomingArcs(VertexId vertex) const {
+        const size_t offset = incoming_offsets_[vertex];
+        return { incoming_sources_.data() + offset, incoming_weights_.data() + offset, incoming_edges_.data() + offset,
+            incoming_offsets_[vertex + 1] - offset };
+    }
+
+    template <typename Weight, typename LowerBound>
+    void AStarRouter<Weight, LowerBound>::ResetBounds() const {
+        for (const VertexId vertex : bounded_vertices_) {
+            bounds_to_target_[vertex] = INFINITE_WEIGHT;
+            if (bidirectional_) {
+                bounds_from_source_[vertex] = INFINITE_WEIGHT;
+            }
+        }
+        bounded_vertices_.clear();
+    }
+
+    template <typename Weight, typename LowerBound>
+    Weight AStarRouter<Weight, LowerBound>::GetBoundToTarget(VertexId vertex) const {
+        if (bounds_to_target_[vertex] == INFINITE_WEIGHT) {
+            bounds_to_target_[vertex] = lower_bound_(vertex, target_);
+            if (bidirectional_) {
+                bounds_from_source_[vertex] = lower_bound_(source_, vertex);
+            }
+            bounded_vertices_.push_back(vertex);
+        }
+        return bounds_to_target_[vertex];
+    }
+
+    template <typename Weight, typename LowerBound>
+    Weight AStarRouter<Weight, LowerBound>::GetBoundFromSource(VertexId vertex) const {
+        GetBoundToTarget(vertex);
+        return bounds_from_source_[vertex];
+    }
+
+    template <typename Weight, typename LowerBound>
+    Weight AStarRouter<Weight, LowerBound>::GetPotential(VertexId vertex) const {
+        if (!bidirectional_) {
+            return GetBoundToTarget(vertex);
+        }
+        return (GetBoundToTarget(vertex) - GetBoundFromSource(vertex)) / 2;
+    }
+
+    template <typename Weight, typename LowerBound>
+    bool AStarRouter<Weight, LowerBound>::HasPreferredPath(VertexId candidate, VertexId current) const {
+        const SearchSpace& search = forward_search_;
+        size_t candidate_max = 0; // greatest vertex id + 1, 0 if there is none
+        size_t current_max = 0;
+        while (candidate != current) {
+            if (search.depths[candidate] >= search.depths[current]) {
+                candidate_max = std::max(candidate_max, candidate + 1);
+                candidate = graph_.GetEdge(search.edges[candidate]).from;
+            }
+            else {
+                current_max = std::max(current_max, current + 1);
+                current = graph_.GetEdge(search.edges[current]).from;
+            }
+        }
+        return candidate_max < current_max;
+    }
+
+    template <typename Weight, typename LowerBound>
+    std::optional<typename AStarRouter<Weight, LowerBound>::RouteInfo> AStarRouter<Weight, LowerBound>::RunSearch(
+        VertexId from, VertexId to) const {
+        SearchSpace& search = forward_search_;
+        search.Push(from, ZERO_WEIGHT, GetPotential(from), NO_EDGE, 0);
+
+        while (const auto item = search.Pop()) {
+            ++settled_count_;
+            if (item->vertex == to) {
+                break;
+            }
+            const Weight item_weight = search.weights[item->vertex];
+            const OutgoingArcs<Weight> arcs = graph_.GetOutgoingArcs(item->vertex);
+            for (size_t i = 0; i < arcs.size; ++i) {
+                const VertexId next = arcs.targets[i];
+                if (search.settled[next]) {
+                    continue;
+                }
+                const Weight candidate_weight = item_weight + arcs.weights[i];
+                const Weight weight = search.weights[next];
+                if (candidate_weight < weight) {
+                    search.Push(next, candidate_weight, candidate_weight + GetPotential(next),
+                        arcs.edges[i], search.depths[item->vertex] + 1);
+                }
+                else if (candidate_weight == weight
+                    && HasPreferredPath(item->vertex, graph_.GetEdge(search.edges[next]).from))
+                {
+                    search.edges[next] = arcs.edges[i];
+                    search.depths[next] = search.depths[item->vertex] + 1;
+                }
+            }
+        }
+
+        if (!search.settled[to]) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = search.edges[to]; edge_id != NO_EDGE; edge_id = search.edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{ search.weights[to], std::move(edges) };
+    }
+
+    template <typename Weight, typename LowerBound>
+    std::optional<typename AStarRouter<Weight, LowerBound>::RouteInfo> AStarRouter<Weight, LowerBound>::RunBidirectionalSearch(
+        VertexId from, VertexId to) const {
+        backward_search_.Reset();
+        forward_search_.Push(from, ZERO_WEIGHT, GetPotential(from), NO_EDGE, 0);
+        backward_search_.Push(to, ZERO_WEIGHT, -GetPotential(to), NO_EDGE, 0);
+
+        Weight best_weight = INFINITE_WEIGHT;
+        VertexId meeting_vertex = from;
+        const auto update_best = [&](VertexId vertex) {
+            if (forward_search_.weights[vertex] == INFINITE_WEIGHT || backward_search_.weights[vertex] == INFINITE_WEIGHT) {
+                return;
+            }
+            const Weight weight = forward_search_.weights[vertex] + backward_search_.weights[vertex];
+            if (weight < best_weight) {
+                best_weight = weight;
+                meeting_vertex = vertex;
+            }
+        };
+        update_best(from);
+
+        // both keys are reduced weights over the same potential, so a route through the frontiers
+        // is not lighter than the sum of their minimal keys
+        while (best_weight == INFINITE_WEIGHT || forward_search_.GetMinKey() + backward_search_.GetMinKey() < best_weight) {
+            const bool forward = forward_search_.GetMinKey() <= backward_search_.GetMinKey();
+            SearchSpace& search = forward ? forward_search_ : backward_search_;
+            const auto item = search.Pop();
+            if (!item) {
+                break; // one of the directions has nothing more to reach
+            }
+            ++settled_count_;
+
+            const Weight item_weight = search.weights[item->vertex];
+            // the backward search walks the reversed graph, whose targets are the sources of the edges
+            const OutgoingArcs<Weight> arcs = forward ? graph_.GetOutgoingArcs(item->vertex) : GetIncomingArcs(item->vertex);
+            for (size_t i = 0; i < arcs.size; ++i) {
+                const VertexId next = arcs.targets[i];
+                const Weight weight = item_weight + arcs.weights[i];
+                if (!search.settled[next] && weight < search.weights[next]) {
+                    const Weight potential = GetPotential(next);
+                    search.Push(next, weight, forward ? weight + potential : weight - potential,
+                        arcs.edges[i], search.depths[item->vertex] + 1);
+                    update_best(next);
+                }
+            }
+        }
+
+        if (best_weight == INFINITE_WEIGHT) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = forward_search_.edges[meeting_vertex]; edge_id != NO_EDGE;
+            edge_id = forward_search_.edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+        for (EdgeId edge_id = backward_search_.edges[meeting_vertex]; edge_id != NO_EDGE;
+            edge_id = backward_search_.edges[graph_.GetEdge(edge_id).to]) {
+            edges.push_back(edge_id);
+        }
+
+        // summed along the route, as the other routers do
+        Weight weight = ZERO_WEIGHT;
+        for (const EdgeId edge_id : edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+        return RouteInfo{ weight, std::move(edges) };
+    }
+
+    template <typename Weight, typename LowerBound>
+    std::optional<typename AStarRouter<Weight, LowerBound>::RouteInfo> AStarRouter<Weight, LowerBound>::BuildRoute(
+        VertexId from, VertexId to) const {
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        forward_search_.Reset();
+        ResetBounds();
+        source_ = from;
+        target_ = to;
+        settled_count_ = 0;
+
+        if (bidirectional_) {
+            return RunBidirectionalSearch(from, to);
+        }
+        return RunSearch(from, to);
+    }
+
+}  // namespace graph
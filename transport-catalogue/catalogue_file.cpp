@@ -0,0 +1,239 @@
+﻿#include "catalogue_file.h"
+#include "route_file.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+using namespace std::literals;
+
+namespace catalogue_file {
+
+    namespace {
+        const char FILE_MAGIC[8] = { 'T', 'C', 'C', 'A', 'T', 'L', 'O', 'G' };
+        const uint32_t FILE_VERSION = 1;
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t key;
+            uint64_t stop_count;
+            uint64_t bus_count;
+            uint64_t route_stop_count;
+            uint64_t distance_count;
+            uint64_t names_size;
+            uint64_t settings_size;
+            uint64_t checksum; // of everything after the header
+        };
+
+        struct StopRecord {
+            double lat;
+            double lng;
+        };
+
+        // the routes lie one after another in the route stops section
+        struct BusRecord {
+            uint64_t stop_count;
+            uint64_t is_roundtrip;
+        };
+
+        struct DistanceRecord {
+            uint32_t from;
+            uint32_t to;
+            int64_t distance;
+        };
+
+        // sections follow the header in this order, each one starts at a multiple of 8 bytes.
+        // Names of the stops and then of the buses are [name_offsets[i], name_offsets[i + 1]) of the names section
+        struct FileLayout {
+            size_t name_offsets_offset;
+            size_t stops_offset;
+            size_t buses_offset;
+            size_t route_stops_offset;
+            size_t distances_offset;
+            size_t names_offset;
+            size_t settings_offset;
+            size_t size;
+        };
+
+        size_t AlignUp(size_t size) {
+            return (size + 7) / 8 * 8;
+        }
+
+        FileLayout ComputeLayout(const FileHeader& header) {
+            FileLayout layout;
+            layout.name_offsets_offset = sizeof(FileHeader);
+            layout.stops_offset = layout.name_offsets_offset + (header.stop_count + header.bus_count + 1) * sizeof(uint64_t);
+            layout.buses_offset = layout.stops_offset + header.stop_count * sizeof(StopRecord);
+            layout.route_stops_offset = layout.buses_offset + header.bus_count * sizeof(BusRecord);
+            layout.distances_offset = AlignUp(layout.route_stops_offset + header.route_stop_count * sizeof(uint32_t));
+            layout.names_offset = layout.distances_offset + header.distance_count * sizeof(DistanceRecord);
+            layout.settings_offset = AlignUp(layout.names_offset + header.names_size);
+            layout.size = AlignUp(layout.settings_offset + header.settings_size);
+            return layout;
+        }
+
+
+        std::runtime_error MakeDamagedError(const std::string& path) {
+            return std::runtime_error("Damaged catalogue file "s + path);
+        }
+    }
+
+    void SaveCatalogue(const std::string& path, const transport_catalogue::TransportCatalogue& catalogue,
+        const json::Dict& settings, uint64_t key) {
+        std::vector<uint64_t> name_offsets{ 0 };
+        std::string names;
+        std::vector<StopRecord> stops;
+        for (transport_catalogue::StopId id = 0; id < catalogue.GetStopCount(); ++id) {
+            const transport_catalogue::Stop stop = catalogue.GetStop(id);
+            names += stop.name;
+            name_offsets.push_back(names.size());
+            stops.push_back({ stop.coordinates.lat, stop.coordinates.lng });
+        }
+        std::vector<BusRecord> buses;
+        std::vector<uint32_t> route_stops;
+        for (transport_catalogue::BusId id = 0; id < catalogue.GetBusCount(); ++id) {
+            const transport_catalogue::Bus bus = catalogue.GetBus(id);
+            names += bus.route_name;
+            name_offsets.push_back(names.size());
+            buses.push_back({ bus.route.size(), bus.is_roundtrip });
+            route_stops.insert(route_stops.end(), bus.route.begin(), bus.route.end());
+        }
+        std::vector<DistanceRecord> distances;
+        catalogue.ForEachDistance([&distances](transport_catalogue::StopId from, transport_catalogue::StopId to, int distance) {
+            distances.push_back({ from, to, distance });
+        });
+        // doubles with all their digits, so that the loaded settings are the same numbers
+        std::ostringstream settings_output;
+        settings_output << std::setprecision(std::numeric_limits<double>::max_digits10);
+        json::Print(json::Document(json::Node(settings)), settings_output);
+        const std::string settings_text = settings_output.str();
+
+        FileHeader header{};
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header.version = FILE_VERSION;
+        header.key = key;
+        header.stop_count = stops.size();
+        header.bus_count = buses.size();
+        header.route_stop_count = route_stops.size();
+        header.distance_count = distances.size();
+        header.names_size = names.size();
+        header.settings_size = settings_text.size();
+        const FileLayout layout = ComputeLayout(header);
+
+        std::string body(layout.size - sizeof(FileHeader), '\0'); // the padding stays zero
+        const auto write_section = [&body](size_t offset, const void* data, size_t size) {
+            if (size > 0) {
+                std::memcpy(body.data() + offset - sizeof(FileHeader), data, size);
+            }
+        };
+        write_section(layout.name_offsets_offset, name_offsets.data(), name_offsets.size() * sizeof(uint64_t));
+        write_section(layout.stops_offset, stops.data(), stops.size() * sizeof(StopRecord));
+        write_section(layout.buses_offset, buses.data(), buses.size() * sizeof(BusRecord));
+        write_section(layout.route_stops_offset, route_stops.data(), route_stops.size() * sizeof(uint32_t));
+        write_section(layout.distances_offset, distances.data(), distances.size() * sizeof(DistanceRecord));
+        write_section(layout.names_offset, names.data(), names.size());
+        write_section(layout.settings_offset, settings_text.data(), settings_text.size());
+        header.checksum = route_file::ComputeHash(body.data(), body.size());
+
+        const std::string temporary_path = path + ".tmp"s;
+        std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(body.data(), body.size());
+        output.close();
+        std::error_code error;
+        if (output) {
+            std::filesystem::rename(temporary_path, path, error);
+        }
+        if (!output || error) {
+            std::filesystem::remove(temporary_path, error);
+            throw std::runtime_error("Cannot write "s + path);
+        }
+    }
+
+    LoadedCatalogue LoadCatalogue(const std::string& path) {
+        const route_file::MappedFile file(path);
+        const char* data = file.GetData();
+
+        FileHeader header;
+        if (file.GetSize() < sizeof(header)) {
+            throw MakeDamagedError(path);
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION) {
+            throw std::runtime_error("Not a catalogue file of version "s + std::to_string(FILE_VERSION) + ": "s + path);
+        }
+        // every count is bounded by the file size, so the layout cannot overflow
+        for (const uint64_t count : { header.stop_count, header.bus_count, header.route_stop_count, header.distance_count,
+            header.names_size, header.settings_size }) {
+            if (count > file.GetSize()) {
+                throw MakeDamagedError(path);
+            }
+        }
+        const FileLayout layout = ComputeLayout(header);
+        if (layout.size != file.GetSize()
+            || route_file::ComputeHash(data + sizeof(header), layout.size - sizeof(header)) != header.checksum) {
+            throw MakeDamagedError(path);
+        }
+
+        const uint64_t* name_offsets = reinterpret_cast<const uint64_t*>(data + layout.name_offsets_offset);
+        const char* names = data + layout.names_offset;
+        const auto get_name = [&](size_t i) {
+            if (name_offsets[i] > name_offsets[i + 1] || name_offsets[i + 1] > header.names_size) {
+                throw MakeDamagedError(path);
+            }
+            return std::string_view(names + name_offsets[i], name_offsets[i + 1] - name_offsets[i]);
+        };
+
+        LoadedCatalogue loaded{ {}, {}, header.key };
+        transport_catalogue::TransportCatalogue& catalogue = loaded.catalogue;
+        const StopRecord* stops = reinterpret_cast<const StopRecord*>(data + layout.stops_offset);
+        for (size_t i = 0; i < header.stop_count; ++i) {
+            catalogue.AddStop(get_name(i), { stops[i].lat, stops[i].lng });
+        }
+
+        const BusRecord* buses = reinterpret_cast<const BusRecord*>(data + layout.buses_offset);
+        const uint32_t* route_stops = reinterpret_cast<const uint32_t*>(data + layout.route_stops_offset);
+        std::vector<transport_catalogue::StopId> route;
+        size_t route_start = 0;
+        for (size_t i = 0; i < header.bus_count; ++i) {
+            if (buses[i].stop_count > header.route_stop_count - route_start) {
+                throw MakeDamagedError(path);
+            }
+            route.assign(route_stops + route_start, route_stops + route_start + buses[i].stop_count);
+            route_start += buses[i].stop_count;
+            try {
+                catalogue.AddBus(get_name(header.stop_count + i), route, buses[i].is_roundtrip != 0);
+            }
+            catch (const std::out_of_range&) {
+                throw MakeDamagedError(path);
+            }
+        }
+        if (route_start != header.route_stop_count) {
+            throw MakeDamagedError(path);
+        }
+
+        const DistanceRecord* distances = reinterpret_cast<const DistanceRecord*>(data + layout.distances_offset);
+        catalogue.ReserveDistances(header.distance_count); // the records are in the slot order of the saved table
+        for (size_t i = 0; i < header.distance_count; ++i) {
+            try {
+                catalogue.AddDistance(distances[i].from, distances[i].to, static_cast<int>(distances[i].distance));
+            }
+            catch (const std::out_of_range&) {
+                throw MakeDamagedError(path);
+            }
+        }
+
+        std::istringstream settings_text(std::string(data + layout.settings_offset, header.settings_size));
+        loaded.settings = json::Load(settings_text).GetRoot().AsDict();
+        return loaded;
+    }
+
+}  // namespace catalogue_file
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include "json.h"
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <string>
+
+namespace catalogue_file {
+
+    // catalogue and the settings stored by SaveCatalogue
+    struct LoadedCatalogue {
+        transport_catalogue::TransportCatalogue catalogue; // not frozen yet
+        json::Dict settings;
+        uint64_t key;
+    };
+
+    // writes the stops, the buses, the road distances and the settings (render_settings, routing_settings)
+    // through a temporary file; key identifies the input they were made from.
+    // Throws std::runtime_error on I/O errors, after removing the temporary file
+    void SaveCatalogue(const std::string& path, const transport_catalogue::TransportCatalogue& catalogue,
+        const json::Dict& settings, uint64_t key);
+
+    // reads the file through a memory mapping. Stop and bus ids are the same as in the saved catalogue.
+    // Throws std::runtime_error if the file cannot be read, has another format version or is damaged
+    LoadedCatalogue LoadCatalogue(const std::string& path);
+
+}  // namespace catalogue_file
@@ -0,0 +1,475 @@
+﻿#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Contraction Hierarchies: vertices are contracted one by one in the order of their importance,
+    // shortcuts keep the distances between the remaining vertices. A query is a bidirectional search
+    // that only goes up the hierarchy. Shortcuts are unpacked back into the edges of the original graph.
+    // Search buffers are reused between queries, so a router object must not be shared between threads
+    template <typename Weight>
+    class ContractionHierarchy final : public RouterBase<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+        using ArcId = size_t;
+
+    public:
+        using typename RouterBase<Weight>::RouteInfo;
+
+        explicit ContractionHierarchy(const Graph& graph);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        size_t GetSettledVertexCount() const override {
+            return settled_count_;
+        }
+
+        size_t GetShortcutCount() const {
+            return arcs_.size() - graph_.GetEdgeCount();
+        }
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+            ? std::numeric_limits<Weight>::infinity()
+            : std::numeric_limits<Weight>::max();
+        static constexpr ArcId NO_ARC = std::numeric_limits<ArcId>::max();
+        // a witness search gives up after settling this many vertices and the shortcut is added
+        static constexpr size_t WITNESS_SEARCH_LIMIT = 500;
+
+        // an edge of the original graph (first is its id, second is NO_ARC) or a shortcut of two arcs
+        struct Arc {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            ArcId first;
+            ArcId second;
+        };
+
+        struct QueueItem {
+            Weight weight;
+            VertexId vertex;
+
+            bool operator>(const QueueItem& other) const {
+                return weight > other.weight || (weight == other.weight && vertex > other.vertex);
+            }
+        };
+
+        struct SearchSpace {
+            std::vector<Weight> weights;
+            std::vector<ArcId> prev_arcs;
+            std::vector<VertexId> touched_vertices;
+            std::vector<QueueItem> queue;
+
+            explicit SearchSpace(size_t vertex_count)
+                : weights(vertex_count, INFINITE_WEIGHT)
+                , prev_arcs(vertex_count, NO_ARC) {
+            }
+
+            void Reset();
+            void Push(VertexId vertex, Weight weight, ArcId arc);
+            std::optional<QueueItem> Pop();
+            Weight GetMinWeight() const;
+        };
+
+        // the lightest arc to every neighbour, in the order of neighbours
+        struct Neighbour {
+            VertexId vertex;
+            ArcId arc;
+        };
+
+        // state of the preprocessing, dropped after the hierarchy is built
+        struct Contraction {
+            std::vector<std::vector<ArcId>> out_arcs;
+            std::vector<std::vector<ArcId>> in_arcs;
+            std::vector<int> contracted_neighbours;
+            SearchSpace witness_search;
+            std::vector<Weight> target_weights; // weights of the arcs to the targets of the contracted vertex
+        };
+
+        void BuildHierarchy();
+
+        std::vector<Neighbour> GetNeighbours(const std::vector<ArcId>& arcs, bool outgoing) const;
+
+        // adds (or only counts if simulate is true) the shortcuts that are needed to contract the vertex
+        size_t ContractVertex(Contraction& contraction, VertexId vertex, bool simulate);
+
+        int ComputePriority(Contraction& contraction, VertexId vertex);
+
+        void UnpackArc(ArcId arc, std::vector<EdgeId>& edges) const;
+
+        const Graph& graph_;
+        std::vector<Arc> arcs_;
+        std::vector<size_t> ranks_;
+        std::vector<std::vector<ArcId>> upward_arcs_;   // arcs to the vertices of higher rank
+        std::vector<std::vector<ArcId>> downward_arcs_; // arcs from the vertices of higher rank
+
+        mutable SearchSpace forward_search_;
+        mutable SearchSpace backward_search_;
+        mutable size_t settled_count_ = 0;
+    };
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::SearchSpace::Reset() {
+        for (const VertexId vertex : touched_vertices) {
+            weights[vertex] = INFINITE_WEIGHT;
+            prev_arcs[vertex] = NO_ARC;
+        }
+        touched_vertices.clear();
+        queue.clear();
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::SearchSpace::Push(VertexId vertex, Weight weight, ArcId arc) {
+        if (weights[vertex] == INFINITE_WEIGHT) {
+            touched_vertices.push_back(vertex);
+        }
+        weights[vertex] = weight;
+        prev_arcs[vertex] = arc;
+        queue.push_back({ weight, vertex });
+        std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::QueueItem> ContractionHierarchy<Weight>::SearchSpace::Pop() {
+        while (!queue.empty()) {
+            std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+            const QueueItem item = queue.back();
+            queue.pop_back();
+            if (item.weight <= weights[item.vertex]) {
+                return item;
+            }
+        }
+        return std::nullopt;
+    }
+
+    template <typename Weight>
+    Weight ContractionHierarchy<Weight>::SearchSpace::GetMinWeight() const {
+        return queue.empty() ? INFINITE_WEIGHT : queue.front().weight;
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+        : graph_(graph)
+        , ranks_(graph.GetVertexCount(), 0)
+        , upward_arcs_(graph.GetVertexCount())
+        , downward_arcs_(graph.GetVertexCount())
+        , forward_search_(graph.GetVertexCount())
+        , backward_search_(graph.GetVertexCount())
+    {
+        arcs_.reserve(graph.GetEdgeCount());
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            arcs_.push_back({ edge.from, edge.to, edge.weight, edge_id, NO_ARC });
+        }
+        BuildHierarchy();
+    }
+
+    template <typename Weight>
+    std::vector<typename ContractionHierarchy<Weight>::Neighbour> ContractionHierarchy<Weight>::GetNeighbours(
+        const std::vector<ArcId>& arcs, bool outgoing) const {
+        std::vector<Neighbour> neighbours;
+        neighbours.reserve(arcs.size());
+        for (const ArcId arc : arcs) {
+            neighbours.push_back({ outgoing ? arcs_[arc].to : arcs_[arc].from, arc });
+        }
+        std::sort(neighbours.begin(), neighbours.end(), [this](const Neighbour& lhs, const Neighbour& rhs) {
+            if (lhs.vertex != rhs.vertex) {
+                return lhs.vertex < rhs.vertex;
+            }
+            if (arcs_[lhs.arc].weight != arcs_[rhs.arc].weight) {
+                return arcs_[lhs.arc].weight < arcs_[rhs.arc].weight;
+            }
+            return lhs.arc < rhs.arc;
+        });
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end(),
+            [](const Neighbour& lhs, const Neighbour& rhs) { return lhs.vertex == rhs.vertex; }), neighbours.end());
+        return neighbours;
+    }
+
+    template <typename Weight>
+    size_t ContractionHierarchy<Weight>::ContractVertex(Contraction& contraction, VertexId vertex, bool simulate) {
+        const std::vector<Neighbour> sources = GetNeighbours(contraction.in_arcs[vertex], false);
+        const std::vector<Neighbour> targets = GetNeighbours(contraction.out_arcs[vertex], true);
+        if (targets.empty()) {
+            return 0;
+        }
+
+        Weight max_target_weight = ZERO_WEIGHT;
+        for (const Neighbour& target : targets) {
+            max_target_weight = std::max(max_target_weight, arcs_[target.arc].weight);
+            contraction.target_weights[target.vertex] = arcs_[target.arc].weight;
+        }
+
+        size_t shortcut_count = 0;
+        SearchSpace& search = contraction.witness_search;
+        for (const Neighbour& source : sources) {
+            const Weight source_weight = arcs_[source.arc].weight;
+            const auto is_witnessed = [&](VertexId target, Weight weight) {
+                return contraction.target_weights[target] != INFINITE_WEIGHT
+                    && weight <= source_weight + contraction.target_weights[target];
+            };
+
+            // looks for paths around the vertex that are not longer than the ones through it,
+            // stops when every target has got one
+            search.Reset();
+            search.Push(source.vertex, ZERO_WEIGHT, NO_ARC);
+            size_t unwitnessed_count = targets.size();
+            size_t settled_count = 0;
+            while (const auto item = search.Pop()) {
+                if (unwitnessed_count == 0 || item->weight > source_weight + max_target_weight
+                    || ++settled_count > WITNESS_SEARCH_LIMIT) {
+                    break;
+                }
+                for (const ArcId arc_id : contraction.out_arcs[item->vertex]) {
+                    const Arc& arc = arcs_[arc_id];
+                    if (arc.to == vertex) {
+                        continue;
+                    }
+                    if (const Weight weight = item->weight + arc.weight; weight < search.weights[arc.to]) {
+                        if (is_witnessed(arc.to, weight) && !is_witnessed(arc.to, search.weights[arc.to])) {
+                            --unwitnessed_count;
+                        }
+                        search.Push(arc.to, weight, arc_id);
+                    }
+                }
+            }
+
+            for (const Neighbour& target : targets) {
+                if (target.vertex == source.vertex) {
+                    continue;
+                }
+                const Weight shortcut_weight = source_weight + arcs_[target.arc].weight;
+                if (search.weights[target.vertex] <= shortcut_weight) {
+                    continue;
+                }
+                ++shortcut_count;
+                if (!simulate) {
+                    const ArcId shortcut = arcs_.size();
+                    arcs_.push_back({ source.vertex, target.vertex, shortcut_weight, source.arc, target.arc });
+                    contraction.out_arcs[source.vertex].push_back(shortcut);
+                    contraction.in_arcs[target.vertex].push_back(shortcut);
+                }
+            }
+        }
+
+        for (const Neighbour& target : targets) {
+            contraction.target_weights[target.vertex] = INFINITE_WEIGHT;
+        }
+        return shortcut_count;
+    }
+
+    template <typename Weight>
+    int ContractionHierarchy<Weight>::ComputePriority(Contraction& contraction, VertexId vertex) {
+        // edge difference plus the number of contracted neighbours, which spreads contraction uniformly
+        const int shortcut_count = static_cast<int>(ContractVertex(contraction, vertex, true));
+        const int removed_count = static_cast<int>(contraction.in_arcs[vertex].size() + contraction.out_arcs[vertex].size());
+        return shortcut_count - removed_count + contraction.contracted_neighbours[vertex];
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::BuildHierarchy() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        Contraction contraction{ std::vector<std::vector<ArcId>>(vertex_count),
+                                 std::vector<std::vector<ArcId>>(vertex_count),
+                                 std::vector<int>(vertex_count, 0),
+                                 SearchSpace(vertex_count),
+                                 std::vector<Weight>(vertex_count, INFINITE_WEIGHT) };
+
+        // of parallel edges only the lightest one (the first one of equal weight) can be on a route
+        std::vector<ArcId> sorted_arcs(arcs_.size());
+        for (ArcId arc = 0; arc < arcs_.size(); ++arc) {
+            sorted_arcs[arc] = arc;
+        }
+        std::sort(sorted_arcs.begin(), sorted_arcs.end(), [this](ArcId lhs, ArcId rhs) {
+            const Arc& l = arcs_[lhs];
+            const Arc& r = arcs_[rhs];
+            return std::tie(l.from, l.to, l.weight, lhs) < std::tie(r.from, r.to, r.weight, rhs);
+        });
+        std::vector<bool> used_arcs(arcs_.size(), false);
+        for (size_t i = 0; i < sorted_arcs.size(); ++i) {
+            const Arc& arc = arcs_[sorted_arcs[i]];
+            if (arc.from == arc.to) {
+                continue;
+            }
+            if (i > 0 && arcs_[sorted_arcs[i - 1]].from == arc.from && arcs_[sorted_arcs[i - 1]].to == arc.to) {
+                continue;
+            }
+            used_arcs[sorted_arcs[i]] = true;
+            contraction.out_arcs[arc.from].push_back(sorted_arcs[i]);
+            contraction.in_arcs[arc.to].push_back(sorted_arcs[i]);
+        }
+
+        using PriorityItem = std::pair<int, VertexId>;
+        std::vector<PriorityItem> queue;
+        queue.reserve(vertex_count);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            queue.push_back({ ComputePriority(contraction, vertex), vertex });
+        }
+        std::make_heap(queue.begin(), queue.end(), std::greater<PriorityItem>{});
+
+        size_t rank = 0;
+        while (!queue.empty()) {
+            std::pop_heap(queue.begin(), queue.end(), std::greater<PriorityItem>{});
+            const VertexId vertex = queue.back().second;
+            queue.pop_back();
+
+            // lazy update: the priority may have grown since the vertex was queued
+            const int priority = ComputePriority(contraction, vertex);
+            if (!queue.empty() && priority > queue.front().first) {
+                queue.push_back({ priority, vertex });
+                std::push_heap(queue.begin(), queue.end(), std::greater<PriorityItem>{});
+                continue;
+            }
+
+            ContractVertex(contraction, vertex, false);
+            ranks_[vertex] = rank++;
+
+            // the remaining graph does not contain the vertex anymore
+            for (const ArcId arc : contraction.in_arcs[vertex]) {
+                auto& arcs = contraction.out_arcs[arcs_[arc].from];
+                arcs.erase(std::remove_if(arcs.begin(), arcs.end(),
+                    [this, vertex](ArcId id) { return arcs_[id].to == vertex; }), arcs.end());
+                ++contraction.contracted_neighbours[arcs_[arc].from];
+            }
+            for (const ArcId arc : contraction.out_arcs[vertex]) {
+                auto& arcs = contraction.in_arcs[arcs_[arc].to];
+                arcs.erase(std::remove_if(arcs.begin(), arcs.end(),
+                    [this, vertex](ArcId id) { return arcs_[id].from == vertex; }), arcs.end());
+                ++contraction.contracted_neighbours[arcs_[arc].to];
+            }
+            contraction.in_arcs[vertex].clear();
+            contraction.out_arcs[vertex].clear();
+        }
+
+        for (ArcId arc = 0; arc < arcs_.size(); ++arc) {
+            const Arc& data = arcs_[arc];
+            if (arc < used_arcs.size() && !used_arcs[arc]) {
+                continue;
+            }
+            if (ranks_[data.from] < ranks_[data.to]) {
+                upward_arcs_[data.from].push_back(arc);
+            }
+            else {
+                downward_arcs_[data.to].push_back(arc);
+            }
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::UnpackArc(ArcId arc, std::vector<EdgeId>& edges) const {
+        std::vector<ArcId> stack{ arc };
+        while (!stack.empty()) {
+            const Arc& data = arcs_[stack.back()];
+            stack.pop_back();
+            if (data.second == NO_ARC) {
+                edges.push_back(data.first);
+            }
+            else {
+                stack.push_back(data.second);
+                stack.push_back(data.first);
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(
+        VertexId from, VertexId to) const {
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        forward_search_.Reset();
+        backward_search_.Reset();
+        settled_count_ = 0;
+        forward_search_.Push(from, ZERO_WEIGHT, NO_ARC);
+        backward_search_.Push(to, ZERO_WEIGHT, NO_ARC);
+
+        Weight best_weight = INFINITE_WEIGHT;
+        VertexId meeting_vertex = from;
+        const auto update_best = [&](VertexId vertex) {
+            if (forward_search_.weights[vertex] == INFINITE_WEIGHT || backward_search_.weights[vertex] == INFINITE_WEIGHT) {
+                return;
+            }
+            const Weight weight = forward_search_.weights[vertex] + backward_search_.weights[vertex];
+            if (weight < best_weight) {
+                best_weight = weight;
+                meeting_vertex = vertex;
+            }
+        };
+
+        // each direction stops when it cannot improve the best route anymore
+        while (true) {
+            const bool forward_active = forward_search_.GetMinWeight() < best_weight;
+            const bool backward_active = backward_search_.GetMinWeight() < best_weight;
+            if (!forward_active && !backward_active) {
+                break;
+            }
+            const bool forward = forward_active
+                && (!backward_active || forward_search_.GetMinWeight() <= backward_search_.GetMinWeight());
+
+            SearchSpace& search = forward ? forward_search_ : backward_search_;
+            const auto item = search.Pop();
+            if (!item) {
+                continue;
+            }
+            ++settled_count_;
+            update_best(item->vertex);
+
+            // stall-on-demand: the vertex is reached cheaper from above, its arcs cannot lead to the best route
+            bool stalled = false;
+            for (const ArcId arc_id : forward ? downward_arcs_[item->vertex] : upward_arcs_[item->vertex]) {
+                const Arc& arc = arcs_[arc_id];
+                const VertexId higher = forward ? arc.from : arc.to;
+                if (search.weights[higher] != INFINITE_WEIGHT && search.weights[higher] + arc.weight < item->weight) {
+                    stalled = true;
+                    break;
+                }
+            }
+            if (stalled) {
+                continue;
+            }
+            for (const ArcId arc_id : forward ? upward_arcs_[item->vertex] : downward_arcs_[item->vertex]) {
+                const Arc& arc = arcs_[arc_id];
+                const VertexId next = forward ? arc.to : arc.from;
+                if (const Weight weight = item->weight + arc.weight; weight < search.weights[next]) {
+                    search.Push(next, weight, arc_id);
+                    update_best(next);
+                }
+            }
+        }
+
+        if (best_weight == INFINITE_WEIGHT) {
+            return std::nullopt;
+        }
+
+        std::vector<ArcId> forward_arcs;
+        for (VertexId vertex = meeting_vertex; forward_search_.prev_arcs[vertex] != NO_ARC;
+            vertex = arcs_[forward_search_.prev_arcs[vertex]].from) {
+            forward_arcs.push_back(forward_search_.prev_arcs[vertex]);
+        }
+        std::vector<EdgeId> edges;
+        for (auto it = forward_arcs.rbegin(); it != forward_arcs.rend(); ++it) {
+            UnpackArc(*it, edges);
+        }
+        for (VertexId vertex = meeting_vertex; backward_search_.prev_arcs[vertex] != NO_ARC;
+            vertex = arcs_[backward_search_.prev_arcs[vertex]].to) {
+            UnpackArc(backward_search_.prev_arcs[vertex], edges);
+        }
+
+        return RouteInfo{ best_weight, std::move(edges) };
+    }
+
+}  // namespace graph
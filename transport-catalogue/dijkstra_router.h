@@ -0,0 +1,243 @@
+﻿#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // answers every query with a single-source Dijkstra search, nothing is precomputed.
+    // Search buffers are reused between queries, so a router object must not be shared between threads.
+    // With cache_capacity > 0 the shortest-path trees of the last cache_capacity sources are kept.
+    //
+    // Routes are the same as the ones of Router: of several routes with equal weight Floyd-Warshall keeps
+    // the one whose set of intermediate vertices is smaller, comparing the sets by the greatest vertex
+    // contained in only one of them. The search applies the same rule when it meets equal weights.
+    // The rule is applied only to the vertices that are not settled yet, which holds while all the edges
+    // weigh more than zero. A zero-weight edge (bus_wait_time 0, zero road distance) can lead to a vertex
+    // that was settled before at the same weight, and that route is not compared, so the routes
+    // may differ from the ones of Router. Their weights are the same, though they may also differ
+    // in rounding, as the weights of a route are summed in another order than in Floyd-Warshall.
+    // The graph has to be frozen. Graph may also be a LineGraph, whose edges are generated during the search
+    template <typename Weight, typename Graph = DirectedWeightedGraph<Weight>>
+    class DijkstraRouter final : public RouterBase<Weight> {
+    public:
+        using typename RouterBase<Weight>::RouteInfo;
+
+        explicit DijkstraRouter(const Graph& graph, size_t cache_capacity = 0);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        // 0 if the route was taken from a cached tree
+        size_t GetSettledVertexCount() const override {
+            return settled_count_;
+        }
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+            ? std::numeric_limits<Weight>::infinity()
+            : std::numeric_limits<Weight>::max();
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        struct ShortestPathTree {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+        };
+
+        struct QueueItem {
+            Weight weight;
+            VertexId vertex;
+
+            // equal weights are settled in the order of vertex ids, which keeps answers deterministic
+            bool operator>(const QueueItem& other) const {
+                return weight > other.weight || (weight == other.weight && vertex > other.vertex);
+            }
+        };
+
+        using CachedTrees = std::unordered_map<VertexId, std::pair<ShortestPathTree, std::list<VertexId>::iterator>>;
+
+        // runs the search from the vertex "from" into the scratch tree,
+        // stops as soon as "to" is settled unless to is std::nullopt
+        void RunSearch(VertexId from, std::optional<VertexId> to) const;
+
+        // true if the intermediate vertices of the scratch tree route to "candidate" are fewer (see above)
+        // than the ones of the route to "current", both vertices have to be settled
+        bool HasPreferredPath(VertexId candidate, VertexId current) const;
+
+        void ResetScratch() const;
+
+        const ShortestPathTree& GetCachedTree(VertexId from) const;
+
+        std::optional<RouteInfo> ExtractRoute(const ShortestPathTree& tree, VertexId to) const;
+
+        const Graph& graph_;
+        size_t cache_capacity_;
+
+        mutable ShortestPathTree scratch_;
+        mutable std::vector<size_t> depths_; // number of edges in the scratch tree route
+        mutable std::vector<bool> settled_;
+        mutable std::vector<VertexId> touched_vertices_;
+        mutable std::vector<QueueItem> queue_;
+        mutable size_t settled_count_ = 0;
+
+        mutable std::list<VertexId> cache_order_; // most recently used source first
+        mutable CachedTrees cached_trees_;
+    };
+
+    template <typename Weight, typename Graph>
+    DijkstraRouter<Weight, Graph>::DijkstraRouter(const Graph& graph, size_t cache_capacity)
+        : graph_(graph)
+        , cache_capacity_(cache_capacity)
+        , scratch_{ std::vector<Weight>(graph.GetVertexCount(), INFINITE_WEIGHT),
+                    std::vector<EdgeId>(graph.GetVertexCount(), NO_EDGE) }
+        , depths_(graph.GetVertexCount(), 0)
+        , settled_(graph.GetVertexCount(), false)
+    {
+        if (graph.HasNegativeWeights()) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    template <typename Weight, typename Graph>
+    void DijkstraRouter<Weight, Graph>::ResetScratch() const {
+        for (const VertexId vertex : touched_vertices_) {
+            scratch_.weights[vertex] = INFINITE_WEIGHT;
+            scratch_.prev_edges[vertex] = NO_EDGE;
+            depths_[vertex] = 0;
+            settled_[vertex] = false;
+        }
+        touched_vertices_.clear();
+        queue_.clear();
+    }
+
+    template <typename Weight, typename Graph>
+    void DijkstraRouter<Weight, Graph>::RunSearch(VertexId from, std::optional<VertexId> to) const {
+        ResetScratch();
+
+        const auto greater = [](const QueueItem& lhs, const QueueItem& rhs) { return lhs > rhs; };
+
+        scratch_.weights[from] = ZERO_WEIGHT;
+        touched_vertices_.push_back(from);
+        queue_.push_back({ ZERO_WEIGHT, from });
+
+        while (!queue_.empty()) {
+            std::pop_heap(queue_.begin(), queue_.end(), greater);
+            const QueueItem item = queue_.back();
+            queue_.pop_back();
+
+            if (settled_[item.vertex] || item.weight > scratch_.weights[item.vertex]) {
+                continue; // outdated queue entry
+            }
+            settled_[item.vertex] = true;
+            ++settled_count_;
+            if (to && item.vertex == *to) {
+                return;
+            }
+
+            graph_.ForEachOutgoingEdge(item.vertex, [&](VertexId next, Weight edge_weight, EdgeId edge_id) {
+                const Weight candidate_weight = item.weight + edge_weight;
+                Weight& weight = scratch_.weights[next];
+                if (candidate_weight < weight) {
+                    if (weight == INFINITE_WEIGHT) {
+                        touched_vertices_.push_back(next);
+                    }
+                    weight = candidate_weight;
+                    scratch_.prev_edges[next] = edge_id;
+                    depths_[next] = depths_[item.vertex] + 1;
+                    queue_.push_back({ candidate_weight, next });
+                    std::push_heap(queue_.begin(), queue_.end(), greater);
+                }
+                else if (candidate_weight == weight && !settled_[next]
+                    && HasPreferredPath(item.vertex, graph_.GetEdge(scratch_.prev_edges[next]).from))
+                {
+                    scratch_.prev_edges[next] = edge_id;
+                    depths_[next] = depths_[item.vertex] + 1;
+                }
+            });
+        }
+    }
+
+    template <typename Weight, typename Graph>
+    bool DijkstraRouter<Weight, Graph>::HasPreferredPath(VertexId candidate, VertexId current) const {
+        // the routes share the part up to their lowest common vertex,
+        // so only the vertices below it decide
+        size_t candidate_max = 0; // greatest vertex id + 1, 0 if there is none
+        size_t current_max = 0;
+        while (candidate != current) {
+            if (depths_[candidate] >= depths_[current]) {
+                candidate_max = std::max(candidate_max, candidate + 1);
+                candidate = graph_.GetEdge(scratch_.prev_edges[candidate]).from;
+            }
+            else {
+                current_max = std::max(current_max, current + 1);
+                current = graph_.GetEdge(scratch_.prev_edges[current]).from;
+            }
+        }
+        return candidate_max < current_max;
+    }
+
+    template <typename Weight, typename Graph>
+    const typename DijkstraRouter<Weight, Graph>::ShortestPathTree& DijkstraRouter<Weight, Graph>::GetCachedTree(VertexId from) const {
+        if (auto it = cached_trees_.find(from); it != cached_trees_.end()) {
+            cache_order_.splice(cache_order_.begin(), cache_order_, it->second.second);
+            return it->second.first;
+        }
+
+        RunSearch(from, std::nullopt);
+
+        ShortestPathTree tree;
+        if (cached_trees_.size() >= cache_capacity_) {
+            // reuse the buffers of the least recently used tree
+            const VertexId evicted = cache_order_.back();
+            cache_order_.pop_back();
+            tree = std::move(cached_trees_.at(evicted).first);
+            cached_trees_.erase(evicted);
+        }
+        tree.weights = scratch_.weights;
+        tree.prev_edges = scratch_.prev_edges;
+
+        cache_order_.push_front(from);
+        return cached_trees_.emplace(from, std::make_pair(std::move(tree), cache_order_.begin())).first->second.first;
+    }
+
+    template <typename Weight, typename Graph>
+    std::optional<typename DijkstraRouter<Weight, Graph>::RouteInfo> DijkstraRouter<Weight, Graph>::ExtractRoute(
+        const ShortestPathTree& tree, VertexId to) const {
+        if (tree.weights[to] == INFINITE_WEIGHT) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = tree.prev_edges[to]; edge_id != NO_EDGE;
+            edge_id = tree.prev_edges[graph_.GetEdge(edge_id).from])
+        {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{ tree.weights[to], std::move(edges) };
+    }
+
+    template <typename Weight, typename Graph>
+    std::optional<typename DijkstraRouter<Weight, Graph>::RouteInfo> DijkstraRouter<Weight, Graph>::BuildRoute(VertexId from,
+        VertexId to) const {
+        if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        settled_count_ = 0;
+        if (cache_capacity_ > 0) {
+            return ExtractRoute(GetCachedTree(from), to);
+        }
+        RunSearch(from, to);
+        return ExtractRoute(scratch_, to);
+    }
+
+}  // namespace graph
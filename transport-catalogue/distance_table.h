@@ -0,0 +1,132 @@
+﻿#pragma once
+
+#include "domain.h"
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+    // road distances between stops in one flat open-addressing table. A distance from A to B is also
+    // the distance from B to A unless that one is given too, so both directions of a pair of stops
+    // share a slot keyed by the packed pair of their ids, and a lookup is a single probe sequence
+    class DistanceTable {
+    public:
+        // the distance from "to" to "from" becomes the same unless it has been given
+        void Add(StopId from, StopId to, int distance) {
+            if ((size_ + 1) * 2 > slots_.size()) {
+                Rehash(slots_.empty() ? 16 : slots_.size() * 2);
+            }
+            const uint64_t key = Pack(from, to);
+            size_t i = Hash(key);
+            while (slots_[i].key != EMPTY_KEY && slots_[i].key != key) {
+                i = (i + 1) & mask_;
+            }
+            Slot& slot = slots_[i];
+            if (slot.key == EMPTY_KEY) {
+                slot.key = key;
+                ++size_;
+            }
+            (from <= to ? slot.forward : slot.backward) = distance;
+        }
+
+        // makes room for the given number of pairs of stops. Distances added in the slot order of another table
+        // would gather into long probe sequences while this one grows, so a copy reserves its size first
+        void Reserve(size_t count) {
+            size_t capacity = slots_.empty() ? 16 : slots_.size();
+            while (count * 2 > capacity) {
+                capacity *= 2;
+            }
+            if (capacity > slots_.size()) {
+                Rehash(capacity);
+            }
+        }
+
+        std::optional<int> Find(StopId from, StopId to) const {
+            if (slots_.empty()) {
+                return std::nullopt;
+            }
+            const uint64_t key = Pack(from, to);
+            for (size_t i = Hash(key);; i = (i + 1) & mask_) {
+                const Slot& slot = slots_[i];
+                if (slot.key == key) {
+                    const int distance = from <= to ? slot.forward : slot.backward;
+                    return distance != NO_DISTANCE ? distance : (from <= to ? slot.backward : slot.forward);
+                }
+                if (slot.key == EMPTY_KEY) {
+                    return std::nullopt;
+                }
+            }
+        }
+
+        // number of pairs of stops
+        size_t GetSize() const {
+            return size_;
+        }
+
+        // calls callback(from, to, distance) for the given distances, not for the ones taken from the other direction
+        template <typename Callback>
+        void ForEach(Callback callback) const {
+            for (const Slot& slot : slots_) {
+                if (slot.key == EMPTY_KEY) {
+                    continue;
+                }
+                const StopId lesser = static_cast<StopId>(slot.key >> 32);
+                const StopId greater = static_cast<StopId>(slot.key);
+                if (slot.forward != NO_DISTANCE) {
+                    callback(lesser, greater, slot.forward);
+                }
+                if (slot.backward != NO_DISTANCE) {
+                    callback(greater, lesser, slot.backward);
+                }
+            }
+        }
+
+    private:
+        static constexpr uint64_t EMPTY_KEY = UINT64_MAX;
+        static constexpr int NO_DISTANCE = INT32_MIN;
+
+        struct Slot {
+            uint64_t key = EMPTY_KEY;
+            int forward = NO_DISTANCE;  // from the lesser stop id to the greater one
+            int backward = NO_DISTANCE;
+        };
+
+        // the lesser id goes first, so that both directions have the same key
+        static uint64_t Pack(StopId from, StopId to) {
+            return from <= to ? static_cast<uint64_t>(from) << 32 | to : static_cast<uint64_t>(to) << 32 | from;
+        }
+
+        size_t Hash(uint64_t key) const {
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+        }
+
+        // capacity is a power of two
+        void Rehash(size_t capacity) {
+            std::vector<Slot> slots(capacity);
+            mask_ = capacity - 1;
+            shift_ = 64;
+            for (size_t c = capacity; c > 1; c >>= 1) {
+                --shift_;
+            }
+            for (const Slot& slot : slots_) {
+                if (slot.key != EMPTY_KEY) {
+                    size_t i = Hash(slot.key);
+                    while (slots[i].key != EMPTY_KEY) {
+                        i = (i + 1) & mask_;
+                    }
+                    slots[i] = slot;
+                }
+            }
+            slots_ = std::move(slots);
+        }
+
+        std::vector<Slot> slots_;
+        size_t size_ = 0;
+        size_t mask_ = 0;
+        int shift_ = 64;
+    };
+
+}  // namespace transport_catalogue
@@ -1,6 +1,10 @@
 ﻿#pragma once
 
+#include "ranges.h"
+
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace geo {
@@ -12,14 +16,21 @@ namespace geo {
 }
 
 namespace transport_catalogue {
+	// dense ids given by the catalogue in the order of adding, from 0
+	using StopId = uint32_t;
+	using BusId = uint32_t;
+
+	// views of the catalogue columns, valid while the catalogue lives
 	struct Stop {
-		std::string name;
+		StopId id;
+		std::string_view name;
 		geo::Coordinates coordinates;
 	};
 
 	struct Bus {
-		std::string route_name;
-		std::vector<Stop*> route;
+		BusId id;
+		std::string_view route_name;
+		ranges::Range<const StopId*> route;
         bool is_roundtrip;
 	};
 
@@ -14,4 +14,13 @@ namespace geo {
             * EARTH_RADIUS;
     }
 
+    double ComputeHaversineDistance(Coordinates from, Coordinates to) {
+        using namespace std;
+        const double dr = M_PI / 180.0;
+        const double lat_sin = sin((to.lat - from.lat) * dr / 2);
+        const double lng_sin = sin((to.lng - from.lng) * dr / 2);
+        const double h = lat_sin * lat_sin + cos(from.lat * dr) * cos(to.lat * dr) * lng_sin * lng_sin;
+        return 2 * asin(min(1.0, sqrt(h))) * EARTH_RADIUS;
+    }
+
 }  // namespace geo
\ No newline at end of file
@@ -5,4 +5,7 @@ namespace geo {
 
     double ComputeDistance(Coordinates from, Coordinates to);
 
+    // the same great-circle distance by the haversine formula, which stays exact for close points
+    double ComputeHaversineDistance(Coordinates from, Coordinates to);
+
 }  // namespace geo
\ No newline at end of file
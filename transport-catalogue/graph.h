@@ -2,7 +2,14 @@
 
 #include "ranges.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace graph {
@@ -12,13 +19,27 @@ namespace graph {
 
     template <typename Weight>
     struct Edge {
-        std::string name;
+        uint32_t name_id; // index in the name table kept by the owner of the graph
         size_t span_count;
         VertexId from;
         VertexId to;
         Weight weight;
     };
 
+    // edges leaving one vertex of a frozen graph: the i-th one has the id edges[i]
+    // and goes to targets[i] with the weight weights[i]
+    template <typename Weight>
+    struct OutgoingArcs {
+        const VertexId* targets;
+        const Weight* weights;
+        const EdgeId* edges;
+        size_t size;
+    };
+
+    // edges are added to per-vertex incidence lists. Freeze() moves the graph into the compressed sparse row
+    // form: the edges of every vertex lie next to each other in flat arrays of targets and weights, which is
+    // what the searches read, while the full edge records stay aside for building the answers.
+    // A frozen graph cannot get new edges
     template <typename Weight>
     class DirectedWeightedGraph {
     private:
@@ -28,6 +49,8 @@ namespace graph {
     public:
         DirectedWeightedGraph() = default;
         explicit DirectedWeightedGraph(size_t vertex_count);
+        // takes all the edges at once, the incidence lists are filled in one pass
+        DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges);
         EdgeId AddEdge(const Edge<Weight>& edge);
 
         size_t GetVertexCount() const;
@@ -35,9 +58,30 @@ namespace graph {
         const Edge<Weight>& GetEdge(EdgeId edge_id) const;
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+        // removes every edge that has an earlier edge with the same ends and not a greater weight.
+        // Searches that keep the first of equally light edges never take such an edge, so their routes
+        // do not change. The remaining edges keep their order, but their ids become dense again.
+        // Returns the number of removed edges
+        size_t RemoveDominatedEdges();
+
+        void Freeze();
+        bool IsFrozen() const;
+        // throws std::logic_error if the graph is not frozen
+        OutgoingArcs<Weight> GetOutgoingArcs(VertexId vertex) const;
+        // calls callback(to, weight, edge_id) for the edges leaving the vertex of a frozen graph
+        template <typename Callback>
+        void ForEachOutgoingEdge(VertexId vertex, Callback callback) const;
+        bool HasNegativeWeights() const;
+
     private:
         std::vector<Edge<Weight>> edges_;
-        std::vector<IncidenceList> incidence_lists_;
+        std::vector<IncidenceList> incidence_lists_; // empty once frozen
+
+        // frozen form, the edges of a vertex v are [arc_offsets_[v], arc_offsets_[v + 1])
+        std::vector<size_t> arc_offsets_;
+        std::vector<VertexId> arc_targets_;
+        std::vector<Weight> arc_weights_;
+        std::vector<EdgeId> arc_edges_;
     };
 
     template <typename Weight>
@@ -45,17 +89,30 @@ namespace graph {
         : incidence_lists_(vertex_count) {
     }
 
+    template <typename Weight>
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges)
+        : edges_(std::move(edges))
+        , incidence_lists_(vertex_count) {
+        for (EdgeId id = 0; id < edges_.size(); ++id) {
+            incidence_lists_.at(edges_[id].from).push_back(id);
+        }
+    }
+
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+        if (IsFrozen()) {
+            throw std::logic_error("Frozen graph cannot get new edges");
+        }
         edges_.push_back(edge);
         const EdgeId id = edges_.size() - 1;
         incidence_lists_.at(edge.from).push_back(id);
         return id;
     }
 
+
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-        return incidence_lists_.size();
+        return IsFrozen() ? arc_offsets_.size() - 1 : incidence_lists_.size();
     }
 
     template <typename Weight>
@@ -71,6 +128,115 @@ namespace graph {
     template <typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
         DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+        if (IsFrozen()) {
+            if (vertex >= GetVertexCount()) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            return { arc_edges_.begin() + arc_offsets_[vertex], arc_edges_.begin() + arc_offsets_[vertex + 1] };
+        }
         return ranges::AsRange(incidence_lists_.at(vertex));
     }
+
+    template <typename Weight>
+    size_t DirectedWeightedGraph<Weight>::RemoveDominatedEdges() {
+        if (IsFrozen()) {
+            throw std::logic_error("Frozen graph cannot be changed");
+        }
+        constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        std::vector<EdgeId> best_edges(GetVertexCount(), NO_EDGE); // by the target, for one source at a time
+        std::vector<bool> is_kept(edges_.size(), false);
+        for (const IncidenceList& incidence_list : incidence_lists_) {
+            for (const EdgeId edge_id : incidence_list) {
+                EdgeId& best_edge = best_edges[edges_[edge_id].to];
+                if (best_edge == NO_EDGE || edges_[edge_id].weight < edges_[best_edge].weight) {
+                    best_edge = edge_id;
+                }
+            }
+            for (const EdgeId edge_id : incidence_list) {
+                EdgeId& best_edge = best_edges[edges_[edge_id].to];
+                if (best_edge != NO_EDGE) {
+                    is_kept[best_edge] = true;
+                    best_edge = NO_EDGE;
+                }
+            }
+        }
+
+        std::vector<EdgeId> new_ids(edges_.size(), NO_EDGE);
+        size_t kept_count = 0;
+        for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+            if (is_kept[edge_id]) {
+                new_ids[edge_id] = kept_count;
+                edges_[kept_count++] = std::move(edges_[edge_id]);
+            }
+        }
+        const size_t removed_count = edges_.size() - kept_count;
+        edges_.resize(kept_count);
+        for (IncidenceList& incidence_list : incidence_lists_) {
+            incidence_list.erase(std::remove_if(incidence_list.begin(), incidence_list.end(),
+                [&is_kept](EdgeId edge_id) { return !is_kept[edge_id]; }), incidence_list.end());
+            for (EdgeId& edge_id : incidence_list) {
+                edge_id = new_ids[edge_id];
+            }
+        }
+        return removed_count;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::Freeze() {
+        if (IsFrozen()) {
+            return;
+        }
+        // the incidence lists hold the edges of a vertex in the order of ids, so a counting sort
+        // by source gives the same order, and the lists can be freed before the arrays are filled
+        const size_t vertex_count = incidence_lists_.size();
+        std::vector<IncidenceList>().swap(incidence_lists_);
+        arc_offsets_.assign(vertex_count + 1, 0);
+        for (const Edge<Weight>& edge : edges_) {
+            ++arc_offsets_[edge.from + 1];
+        }
+        std::partial_sum(arc_offsets_.begin(), arc_offsets_.end(), arc_offsets_.begin());
+
+        arc_targets_.resize(edges_.size());
+        arc_weights_.resize(edges_.size());
+        arc_edges_.resize(edges_.size());
+        std::vector<size_t> positions(arc_offsets_.begin(), arc_offsets_.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+            const size_t position = positions[edges_[edge_id].from]++;
+            arc_targets_[position] = edges_[edge_id].to;
+            arc_weights_[position] = edges_[edge_id].weight;
+            arc_edges_[position] = edge_id;
+        }
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+        return !arc_offsets_.empty();
+    }
+
+    template <typename Weight>
+    OutgoingArcs<Weight> DirectedWeightedGraph<Weight>::GetOutgoingArcs(VertexId vertex) const {
+        if (!IsFrozen()) {
+            throw std::logic_error("Graph is not frozen");
+        }
+        if (vertex >= GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const size_t offset = arc_offsets_[vertex];
+        return { arc_targets_.data() + offset, arc_weights_.data() + offset, arc_edges_.data() + offset,
+            arc_offsets_[vertex + 1] - offset };
+    }
+
+    template <typename Weight>
+    template <typename Callback>
+    void DirectedWeightedGraph<Weight>::ForEachOutgoingEdge(VertexId vertex, Callback callback) const {
+        const OutgoingArcs<Weight> arcs = GetOutgoingArcs(vertex);
+        for (size_t i = 0; i < arcs.size; ++i) {
+            callback(arcs.targets[i], arcs.weights[i], arcs.edges[i]);
+        }
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::HasNegativeWeights() const {
+        return std::any_of(edges_.begin(), edges_.end(), [](const Edge<Weight>& edge) { return edge.weight < Weight{}; });
+    }
 }  // namespace graph
\ No newline at end of file
@@ -18,22 +18,31 @@ namespace json {
             return s;
         }
 
-        Node LoadArray(std::istream& input) {
-            std::vector<Node> result;
-
+        // passes the items to the callback, the opening bracket has been read
+        template <typename Callback>
+        void LoadArrayItems(std::istream& input, const Callback& callback) {
             for (char c; input >> c && c != ']';) {
                 if (c != ',') {
                     input.putback(c);
                 }
-                result.push_back(LoadNode(input));
+                callback(LoadNode(input));
             }
             if (!input) {
                 throw ParsingError("Array parsing error"s);
             }
+        }
+
+        Node LoadArray(std::istream& input) {
+            std::vector<Node> result;
+            LoadArrayItems(input, [&result](Node item) {
+                result.push_back(std::move(item));
+            });
             return Node(std::move(result));
         }
 
-        Node LoadDict(std::istream& input) {
+        // the array under array_key is streamed to the callback, if there is one
+        Node LoadDict(std::istream& input, const std::string* array_key = nullptr,
+            const std::function<void(Node)>* callback = nullptr) {
             Dict dict;
 
             for (char c; input >> c && c != '}';) {
@@ -43,6 +52,14 @@ namespace json {
                         if (dict.find(key) != dict.end()) {
                             throw ParsingError("Duplicate key '"s + key + "' have been found");
                         }
+                        if (callback && key == *array_key && input >> c) {
+                            if (c == '[') {
+                                LoadArrayItems(input, *callback);
+                                dict.emplace(std::move(key), Array{});
+                                continue;
+                            }
+                            input.putback(c);
+                        }
                         dict.emplace(std::move(key), LoadNode(input));
                     }
                     else {
@@ -350,6 +367,18 @@ namespace json {
         return Document{ LoadNode(input) };
     }
 
+    Document LoadStreaming(std::istream& input, const std::string& array_key, const std::function<void(Node)>& callback) {
+        char c;
+        if (!(input >> c)) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        if (c != '{') {
+            input.putback(c);
+            return Document{ LoadNode(input) };
+        }
+        return Document{ LoadDict(input, &array_key, &callback) };
+    }
+
     void Print(const Document& doc, std::ostream& output) {
         PrintNode(doc.GetRoot(), PrintContext{ output });
     }
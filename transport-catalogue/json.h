@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <functional>
 #include <iostream>
 #include <map>
 #include <string>
@@ -142,6 +143,11 @@ namespace json {
 
     Document Load(std::istream& input);
 
+    // loads the document like Load, except for the array under the key array_key of the root dict:
+    // its items are given to the callback one by one as soon as they are parsed, so they are never
+    // held together, and the document keeps an empty array there
+    Document LoadStreaming(std::istream& input, const std::string& array_key, const std::function<void(Node)>& callback);
+
     void Print(const Document& doc, std::ostream& output);
 
 }  // namespace json
\ No newline at end of file
@@ -1,73 +1,214 @@
 ﻿#include "json_reader.h"
+#include "catalogue_file.h"
 #include "json_builder.h"
+#include "route_file.h"
 
 using namespace std::literals;
 
-// sorting requests for adding to the catalog
-void JsonReader::SortInputRequests(std::vector<json::Node>& buses, std::vector<json::Node>& stops) {
+uint64_t ComputeNodeHash(const json::Node& node, uint64_t hash);
 
-    for (const json::Node& node : doc_.GetRoot().AsDict().at("base_requests"s).AsArray()) {
-        if (node.AsDict().at("type"s).AsString() == "Bus"s) {
-            buses.emplace_back(std::move(node));
+// adding a stop and distances
+void JsonReader::AddStop(const json::Dict& request, transport_catalogue::TransportCatalogue& catalogue,
+    std::vector<DeferredDistance>& deferred_distances) {
+
+    geo::Coordinates coordinates{ request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble() };
+    const transport_catalogue::StopId stop_from = catalogue.AddStop(request.at("name"s).AsString(), coordinates);
+    for (const auto& [stop_to, distance] : request.at("road_distances"s).AsDict()) {
+        if (const std::optional<transport_catalogue::Stop> stop = catalogue.FindStop(stop_to)) {
+            catalogue.AddDistance(stop_from, stop->id, distance.AsInt());
         }
         else {
-            stops.emplace_back(std::move(node));
+            deferred_distances.push_back({ stop_from, stop_to, distance.AsInt() });
         }
     }
 }
 
-// adding stops and distances
-void JsonReader::AddStops(std::vector<json::Node>* stops) {
+// adding a bus
+bool JsonReader::AddBus(const json::Dict& request, transport_catalogue::TransportCatalogue& catalogue, bool wait_for_stops) {
 
-    // adding stops
-    for (json::Node& node : *stops) {
-        geo::Coordinates coordinates{ node.AsDict().at("latitude"s).AsDouble(), node.AsDict().at("longitude"s).AsDouble() };
-        catalogue_.AddStop(node.AsDict().at("name"s).AsString(), coordinates);
-    }
-    // adding distances
-    for (json::Node& node : *stops) {
-        std::string_view stop_from = node.AsDict().at("name"s).AsString();
-        for (const std::pair<const std::string, json::Node>& stop_to : node.AsDict().at("road_distances"s).AsDict()) {
-            catalogue_.AddDistances(stop_from, stop_to);
+    bool is_round = request.at("is_roundtrip"s).AsBool();
+    std::vector<std::string_view> stops;
+    for (const json::Node& stop_node : request.at("stops"s).AsArray()) {
+        if (wait_for_stops && !catalogue.FindStop(stop_node.AsString())) {
+            return false;
         }
+        stops.emplace_back(stop_node.AsString());
     }
+    if (!is_round) {
+        std::vector<std::string_view> stops_copy(stops.begin(), stops.end());
+        stops.insert(stops.end(), std::next(stops_copy.rbegin()), stops_copy.rend());
+    }
+
+    catalogue.AddBus(request.at("name"s).AsString(), move(stops), is_round);
+    return true;
 }
 
-// adding buses
-void JsonReader::AddBuses(std::vector<json::Node>* buses) {
+void JsonReader::FillCatalogue(std::istream& input, RunMode mode) {
 
-    for (json::Node& node : *buses) {
-        bool is_round = node.AsDict().at("is_roundtrip"s).AsBool();
-        std::vector<std::string_view> stops;
-        for (const json::Node& stop_node : node.AsDict().at("stops"s).AsArray()) {
-            stops.emplace_back(stop_node.AsString());
+    transport_catalogue::TransportCatalogue catalogue;
+    std::vector<DeferredDistance> deferred_distances;
+    std::vector<json::Node> deferred_buses;
+    // hash of the requests followed by their number
+    uint64_t base_key = route_file::ComputeHash(nullptr, 0);
+    uint64_t request_count = 0;
+
+    doc_ = json::LoadStreaming(input, "base_requests"s, [&](json::Node request) {
+        if (mode == RunMode::PROCESS_REQUESTS) {
+            return;
+        }
+        base_key = ComputeNodeHash(request, base_key);
+        ++request_count;
+        const json::Dict& fields = request.AsDict();
+        if (fields.at("type"s).AsString() != "Bus"s) {
+            AddStop(fields, catalogue, deferred_distances);
         }
-        if (!is_round) {
-            std::vector<std::string_view> stops_copy(stops.begin(), stops.end());
-            stops.insert(stops.end(), std::next(stops_copy.rbegin()), stops_copy.rend());
+        else if (!AddBus(fields, catalogue, true)) {
+            deferred_buses.push_back(std::move(request));
         }
+    });
 
-        catalogue_.AddBus(node.AsDict().at("name"s).AsString(), move(stops), is_round);
+    const json::Dict& root = doc_.GetRoot().AsDict();
+    const bool has_base_requests = root.count("base_requests"s) > 0;
+    if (mode == RunMode::MAKE_BASE && !has_base_requests) {
+        throw std::invalid_argument("make_base needs base_requests"s);
     }
-}
-
-void JsonReader::FillCatalogue() {
+    if (mode == RunMode::PROCESS_REQUESTS || !has_base_requests) {
+        const std::string& path = root.at("serialization_settings"s).AsDict().at("file"s).AsString();
+        catalogue_file::LoadedCatalogue loaded = catalogue_file::LoadCatalogue(path);
+        json::Dict merged_root = root;
+        merged_root.merge(loaded.settings);
+        doc_ = json::Document(json::Node(std::move(merged_root)));
+        base_key_ = loaded.key;
+        snapshots_.Publish(std::move(loaded.catalogue));
+        return;
+    }
+    base_key_ = route_file::ComputeHash(&request_count, sizeof(request_count), base_key);
 
-    std::vector<json::Node> buses_input;
-    std::vector<json::Node> stops_input;
+    for (const DeferredDistance& distance : deferred_distances) {
+        const std::optional<transport_catalogue::Stop> stop = catalogue.FindStop(distance.to);
+        if (!stop) {
+            throw std::out_of_range("Unknown stop"s);
+        }
+        catalogue.AddDistance(distance.from, stop->id, distance.distance);
+    }
+    for (const json::Node& request : deferred_buses) {
+        AddBus(request.AsDict(), catalogue, false);
+    }
 
-    SortInputRequests(buses_input, stops_input);
+    snapshots_.Publish(std::move(catalogue));
+}
 
-    AddStops(&stops_input);
+void JsonReader::SaveCatalogue() const {
+    const json::Dict& root = doc_.GetRoot().AsDict();
+    json::Dict settings;
+    for (const std::string& key : { "render_settings"s, "routing_settings"s }) {
+        if (const auto it = root.find(key); it != root.end()) {
+            settings.emplace(key, it->second);
+        }
+    }
+    catalogue_file::SaveCatalogue(root.at("serialization_settings"s).AsDict().at("file"s).AsString(),
+        *snapshots_.Get(), settings, base_key_);
+}
 
-    AddBuses(&buses_input);
+// hash of the node contents, numbers are taken by their binary values
+uint64_t ComputeNodeHash(const json::Node& node, uint64_t hash) {
+    const auto hash_string = [&hash](const std::string& value) {
+        const uint64_t size = value.size();
+        hash = route_file::ComputeHash(&size, sizeof(size), hash);
+        hash = route_file::ComputeHash(value.data(), value.size(), hash);
+    };
 
+    const uint64_t type = node.GetValue().index();
+    hash = route_file::ComputeHash(&type, sizeof(type), hash);
+    if (node.IsArray()) {
+        const uint64_t size = node.AsArray().size();
+        hash = route_file::ComputeHash(&size, sizeof(size), hash);
+        for (const json::Node& item : node.AsArray()) {
+            hash = ComputeNodeHash(item, hash);
+        }
+    }
+    else if (node.IsDict()) {
+        const uint64_t size = node.AsDict().size();
+        hash = route_file::ComputeHash(&size, sizeof(size), hash);
+        for (const auto& [key, value] : node.AsDict()) {
+            hash_string(key);
+            hash = ComputeNodeHash(value, hash);
+        }
+    }
+    else if (node.IsString()) {
+        hash_string(node.AsString());
+    }
+    else if (node.IsPureDouble()) {
+        const double value = node.AsDouble();
+        hash = route_file::ComputeHash(&value, sizeof(value), hash);
+    }
+    else if (node.IsInt()) {
+        const int value = node.AsInt();
+        hash = route_file::ComputeHash(&value, sizeof(value), hash);
+    }
+    else if (node.IsBool()) {
+        const bool value = node.AsBool();
+        hash = route_file::ComputeHash(&value, sizeof(value), hash);
+    }
+    return hash;
 }
 
 void JsonReader::SetRouterSettings() {
     const json::Dict& router_sets_dict = doc_.GetRoot().AsDict().at("routing_settings"s).AsDict();
     router_.SetVelocity(router_sets_dict.at("bus_velocity"s).AsDouble())
         .SetWaitTime(router_sets_dict.at("bus_wait_time"s).AsInt());
+
+    // optional settings of the routing engine
+    if (const auto it = router_sets_dict.find("router"s); it != router_sets_dict.end()) {
+        const std::string& type = it->second.AsString();
+        if (type == "all_pairs"s) {
+            router_.SetRouterType(RouterType::ALL_PAIRS);
+        }
+        else if (type == "dijkstra"s) {
+            router_.SetRouterType(RouterType::DIJKSTRA);
+        }
+        else if (type == "contraction_hierarchies"s) {
+            router_.SetRouterType(RouterType::CONTRACTION_HIERARCHIES);
+        }
+        else if (type == "astar"s) {
+            router_.SetRouterType(RouterType::ASTAR);
+        }
+        else if (type == "bidirectional_astar"s) {
+            router_.SetRouterType(RouterType::BIDIRECTIONAL_ASTAR);
+        }
+        else if (type == "implicit_dijkstra"s) {
+            router_.SetRouterType(RouterType::IMPLICIT_DIJKSTRA);
+        }
+        else {
+            throw std::invalid_argument("Invalid router type"s);
+        }
+    }
+    if (const auto it = router_sets_dict.find("route_cache_size"s); it != router_sets_dict.end()) {
+        router_.SetRouteCacheSize(it->second.AsInt());
+    }
+    if (const auto it = router_sets_dict.find("response_cache_size"s); it != router_sets_dict.end()) {
+        const auto shards_it = router_sets_dict.find("response_cache_shards"s);
+        router_.SetResponseCacheSize(it->second.AsInt(), shards_it != router_sets_dict.end() ? shards_it->second.AsInt() : 16);
+    }
+    if (const auto it = router_sets_dict.find("compact_route_table"s); it != router_sets_dict.end()) {
+        router_.SetCompactRouteTable(it->second.AsBool());
+    }
+    if (const auto it = router_sets_dict.find("router_threads"s); it != router_sets_dict.end()) {
+        // 0 means one thread per hardware core
+        const int threads = it->second.AsInt();
+        router_.SetThreadCount(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    }
+    if (const auto it = router_sets_dict.find("route_file"s); it != router_sets_dict.end()) {
+        // the file is valid only for the same stops, buses and settings
+        const uint64_t key = ComputeNodeHash(doc_.GetRoot().AsDict().at("routing_settings"s), base_key_);
+        router_.SetRouteFile(it->second.AsString(), key);
+    }
+    if (const auto it = router_sets_dict.find("remove_dominated_edges"s); it != router_sets_dict.end()) {
+        router_.SetRemoveDominatedEdges(it->second.AsBool());
+    }
+    if (const auto it = router_sets_dict.find("report_settled_vertices"s); it != router_sets_dict.end()) {
+        report_settled_vertices_ = it->second.AsBool();
+    }
 }
 
 void MakeErrorResponse(json::Builder& builder, int id) {
@@ -78,7 +219,8 @@ void MakeErrorResponse(json::Builder& builder, int id) {
 }
 
 json::Document JsonReader::FormResponce(const json::Array* stat_requests) {
-    router_.BuildGraph(catalogue_);
+    const transport_catalogue::SnapshotHolder::Snapshot catalogue = snapshots_.Get();
+    router_.BuildGraph(*catalogue);
     json::Builder builder{}; // gives Node
 
     builder.StartArray();
@@ -88,7 +230,7 @@ json::Document JsonReader::FormResponce(const json::Array* stat_requests) {
         int id = node.AsDict().at("id"s).AsInt();
 
         if (node.AsDict().at("type"s).AsString() == "Bus"s) {
-            if (std::optional<transport_catalogue::BusInfo> bus = catalogue_.GetBusInfo(node.AsDict().at("name"s).AsString()); bus != std::nullopt) {
+            if (std::optional<transport_catalogue::BusInfo> bus = catalogue->GetBusInfo(node.AsDict().at("name"s).AsString()); bus != std::nullopt) {
                 builder.StartDict()
                     .Key("curvature"s).Value(bus->curvature)
                     .Key("request_id"s).Value(id)
@@ -103,12 +245,12 @@ json::Document JsonReader::FormResponce(const json::Array* stat_requests) {
         }
         else if (node.AsDict().at("type"s).AsString() == "Stop"s) 
             {
-                if (std::optional<std::set<std::string_view>> buses_of_stop = catalogue_.GetStopInfo(node.AsDict().at("name"s).AsString()); buses_of_stop != std::nullopt) {
+                if (const auto buses_of_stop = catalogue->GetStopInfo(node.AsDict().at("name"s).AsString()); buses_of_stop != std::nullopt) {
 
                     builder.StartDict().Key("buses"s).StartArray();
 
-                    for (const std::string_view& bus : *buses_of_stop) {
-                        builder.Value(static_cast<std::string>(bus));
+                    for (const transport_catalogue::BusId bus : *buses_of_stop) {
+                        builder.Value(static_cast<std::string>(catalogue->GetBus(bus).route_name));
                     }
                     builder.EndArray()
                         .Key("request_id"s).Value(id)
@@ -123,7 +265,7 @@ json::Document JsonReader::FormResponce(const json::Array* stat_requests) {
 
                     std::ostringstream outstream;
 
-                    MapRenderer map_renderer(&doc_, &catalogue_);
+                    MapRenderer map_renderer(&doc_, catalogue.get());
                     map_renderer.CreateMap().RenderMap(outstream);
 
                     builder.StartDict()
@@ -133,51 +275,156 @@ json::Document JsonReader::FormResponce(const json::Array* stat_requests) {
                 }
             else if (node.AsDict().at("type"s).AsString() == "Route"s)
         {
-            const auto& routing = router_.FindRoute(node.AsDict().at("from").AsString(), node.AsDict().at("to").AsString());
-            if (routing) {
-                double total_time = 0.0;
-                json::Array items;
-                items.reserve(routing.value().edges.size());
-                for (auto& edge_id : routing.value().edges) {
-                    const graph::Edge<double> edge = router_.GetGraph().GetEdge(edge_id);
-                    if (edge.span_count == 0) {
-                        items.emplace_back(json::Node(json::Builder{}
-                            .StartDict()
-                            .Key("stop_name").Value(edge.name)
-                            .Key("time").Value(edge.weight)
-                            .Key("type").Value("Wait")
-                            .EndDict()
-                            .Build().AsDict()
-                        )
-                        );
-                        total_time += edge.weight;
-                    }
-                    else {
-                        items.emplace_back(json::Node(json::Builder{}
-                            .StartDict()
-                            .Key("bus").Value(edge.name)
-                            .Key("span_count").Value(static_cast<int>(edge.span_count))
-                            .Key("time").Value(edge.weight)
-                            .Key("type").Value("Bus")
-                            .EndDict()
-                            .Build().AsDict()
-                        )
-                        );
-                        total_time += edge.weight;
+            const std::string& from = node.AsDict().at("from").AsString();
+            const std::string& to = node.AsDict().at("to").AsString();
+            TransportRouter::RouteResponse response = router_.FindRouteResponse(from, to);
+            const bool is_cached = response != nullptr;
+            if (!is_cached) {
+                // an empty response is kept for the pairs without a route
+                response = std::make_shared<const json::Dict>();
+                if (const auto& routing = router_.FindRoute(from, to)) {
+                    double total_time = 0.0;
+                    json::Array items;
+                    items.reserve(routing.value().edges.size());
+                    for (auto& edge_id : routing.value().edges) {
+                        const graph::Edge<double> edge = router_.GetEdge(edge_id);
+                        if (edge.span_count == 0) {
+                            items.emplace_back(json::Node(json::Builder{}
+                                .StartDict()
+                                .Key("stop_name").Value(std::string(router_.GetEdgeName(edge)))
+                                .Key("time").Value(edge.weight)
+                                .Key("type").Value("Wait")
+                                .EndDict()
+                                .Build().AsDict()
+                            )
+                            );
+                            total_time += edge.weight;
+                        }
+                        else {
+                            items.emplace_back(json::Node(json::Builder{}
+                                .StartDict()
+                                .Key("bus").Value(std::string(router_.GetEdgeName(edge)))
+                                .Key("span_count").Value(static_cast<int>(edge.span_count))
+                                .Key("time").Value(edge.weight)
+                                .Key("type").Value("Bus")
+                                .EndDict()
+                                .Build().AsDict()
+                            )
+                            );
+                            total_time += edge.weight;
+                        }
                     }
+                    response = std::make_shared<const json::Dict>(json::Dict{ { "items"s, std::move(items) }, { "total_time"s, total_time } });
                 }
-
+                router_.AddRouteResponse(from, to, response);
+            }
+            if (!response->empty()) {
                 builder.StartDict()
                     .Key("items")
-                    .Value(items)
-                    .Key("total_time").Value(total_time)
-                    .Key("request_id").Value(id)
+                    .Value(response->at("items"s).GetValue())
+                    .Key("total_time").Value(response->at("total_time"s).GetValue());
+                if (report_settled_vertices_) {
+                    builder.Key("settled_vertex_count").Value(is_cached ? 0 : static_cast<int>(router_.GetSettledVertexCount()));
+                }
+                builder.Key("request_id").Value(id)
                     .EndDict();
             }
             else {
                 MakeErrorResponse(builder, id);
             }
 
+        }
+        else if (node.AsDict().at("type"s).AsString() == "RouteCacheStats"s) {
+            const auto stats = router_.GetResponseCacheStats();
+            builder.StartDict()
+                .Key("evictions"s).Value(static_cast<int>(stats.evictions))
+                .Key("hits"s).Value(static_cast<int>(stats.hits))
+                .Key("misses"s).Value(static_cast<int>(stats.misses))
+                .Key("request_id"s).Value(id)
+                .Key("size"s).Value(static_cast<int>(stats.size))
+                .EndDict();
+        }
+        else if (node.AsDict().at("type"s).AsString() == "RouterStats"s) {
+            // the table size in KB, so that it fits an int
+            const size_t vertex_count = router_.GetGraph().GetVertexCount();
+            const size_t table_size = router_.GetRouteTableSize();
+            builder.StartDict()
+                .Key("edge_count"s).Value(static_cast<int>(router_.GetGraph().GetEdgeCount()))
+                .Key("removed_edge_count"s).Value(static_cast<int>(router_.GetRemovedEdgeCount()))
+                .Key("request_id"s).Value(id)
+                .Key("route_table_bytes_per_pair"s).Value(vertex_count > 0
+                    ? static_cast<double>(table_size) / (vertex_count * vertex_count) : 0.0)
+                .Key("route_table_kb"s).Value(static_cast<int>((table_size + 1023) / 1024))
+                .Key("vertex_count"s).Value(static_cast<int>(router_.GetGraph().GetVertexCount()))
+                .EndDict();
+        }
+        else if (node.AsDict().at("type"s).AsString() == "Isochrone"s) {
+            if (const auto stops = router_.FindReachableStops(node.AsDict().at("from"s).AsString(),
+                node.AsDict().at("max_time"s).AsDouble())) {
+                builder.StartDict().Key("request_id"s).Value(id).Key("stops"s).StartArray();
+                for (const auto& [stop_name, time] : *stops) {
+                    builder.StartDict()
+                        .Key("stop_name"s).Value(std::string(stop_name))
+                        .Key("time"s).Value(time)
+                        .EndDict();
+                }
+                builder.EndArray().EndDict();
+            }
+            else {
+                MakeErrorResponse(builder, id);
+            }
+        }
+        else if (node.AsDict().at("type"s).AsString() == "Matrix"s) {
+            std::vector<std::string_view> from;
+            for (const json::Node& stop_node : node.AsDict().at("from"s).AsArray()) {
+                from.emplace_back(stop_node.AsString());
+            }
+            std::vector<std::string_view> to;
+            for (const json::Node& stop_node : node.AsDict().at("to"s).AsArray()) {
+                to.emplace_back(stop_node.AsString());
+            }
+            if (const auto matrix = router_.FindTimeMatrix(from, to)) {
+                // a row per source stop, null where the target cannot be reached
+                builder.StartDict().Key("request_id"s).Value(id).Key("times"s).StartArray();
+                for (const auto& row : *matrix) {
+                    builder.StartArray();
+                    for (const std::optional<double>& time : row) {
+                        if (time) {
+                            builder.Value(*time);
+                        }
+                        else {
+                            builder.Value(nullptr);
+                        }
+                    }
+                    builder.EndArray();
+                }
+                builder.EndArray().EndDict();
+            }
+            else {
+                MakeErrorResponse(builder, id);
+            }
+        }
+        else if (node.AsDict().at("type"s).AsString() == "NearestStops"s) {
+            const geo::Coordinates point{ node.AsDict().at("latitude"s).AsDouble(), node.AsDict().at("longitude"s).AsDouble() };
+            builder.StartDict().Key("request_id"s).Value(id).Key("stops"s).StartArray();
+            for (const auto& [stop, distance] : catalogue->FindNearestStops(point,
+                static_cast<size_t>(std::max(0, node.AsDict().at("count"s).AsInt())))) {
+                builder.StartDict()
+                    .Key("distance"s).Value(distance)
+                    .Key("stop_name"s).Value(std::string(stop.name))
+                    .EndDict();
+            }
+            builder.EndArray().EndDict();
+        }
+        else if (node.AsDict().at("type"s).AsString() == "StopsInBox"s) {
+            const json::Dict& request = node.AsDict();
+            const geo::Coordinates min{ request.at("min_latitude"s).AsDouble(), request.at("min_longitude"s).AsDouble() };
+            const geo::Coordinates max{ request.at("max_latitude"s).AsDouble(), request.at("max_longitude"s).AsDouble() };
+            builder.StartDict().Key("request_id"s).Value(id).Key("stops"s).StartArray();
+            for (const transport_catalogue::Stop& stop : catalogue->FindStopsInBox(min, max)) {
+                builder.Value(std::string(stop.name));
+            }
+            builder.EndArray().EndDict();
         }
                 else {
                     throw std::invalid_argument("Invalid request type"s);
@@ -13,11 +13,18 @@
 #include "map_renderer.h"
 #include "transport_router.h"
 
+// what a run takes from its input
+enum class RunMode {
+    DIRECT,           // the catalogue from base_requests, or from the file of serialization_settings without them
+    MAKE_BASE,        // the catalogue from base_requests, which are required, to be saved by SaveCatalogue
+    PROCESS_REQUESTS, // the catalogue from the file of serialization_settings, base_requests are ignored
+};
+
 class JsonReader {
 public:
-    JsonReader(std::istream& input)
-        : doc_(json::Load(input)) {
-        FillCatalogue();
+    JsonReader(std::istream& input, RunMode mode = RunMode::DIRECT)
+        : doc_(json::Node(nullptr)) {
+        FillCatalogue(input, mode);
         SetRouterSettings();
     }
 
@@ -25,21 +32,37 @@ public:
         PrintRequests(output);
     }
 
+    // writes the catalogue and the render and routing settings to the file of serialization_settings,
+    // for the runs that are given no base_requests
+    void SaveCatalogue() const;
+
 private:
     json::Document doc_;
-    transport_catalogue::TransportCatalogue catalogue_;
+    transport_catalogue::SnapshotHolder snapshots_; // the router refers to the current snapshot
+    uint64_t base_key_ = 0; // hash of the base_requests the catalogue was made from
     TransportRouter router_;
+    bool report_settled_vertices_ = false; // adds the search effort to the Route responses
 
-    // sorting requests for adding to the catalog
-    void SortInputRequests(std::vector<json::Node>& buses, std::vector<json::Node>& stops);
+    // distance to a stop that is not added yet, added after all the base_requests
+    struct DeferredDistance {
+        transport_catalogue::StopId from;
+        std::string to;
+        int distance;
+    };
 
-    // adding stops and distances
-    void AddStops(std::vector<json::Node>* stops);
+    // adding a stop and its distances to the stops added before it
+    void AddStop(const json::Dict& request, transport_catalogue::TransportCatalogue& catalogue,
+        std::vector<DeferredDistance>& deferred_distances);
 
-    // adding buses
-    void AddBuses(std::vector<json::Node>* buses);
+    // adding a bus. If some of its stops are not added yet, it is not added and false is returned
+    // while wait_for_stops, otherwise the stops are left out of its route
+    bool AddBus(const json::Dict& request, transport_catalogue::TransportCatalogue& catalogue, bool wait_for_stops);
 
-    void FillCatalogue();
+    // reads the input, the base_requests are added to the catalogue one by one while they are parsed.
+    // When the catalogue comes from the file of serialization_settings, the settings saved there
+    // are added to the document unless it has its own.
+    // Throws std::invalid_argument if a MAKE_BASE input has no base_requests
+    void FillCatalogue(std::istream& input, RunMode mode);
     void SetRouterSettings();
 
     void PrintRequests(std::ostream& output);
@@ -0,0 +1,157 @@
+﻿#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // graph whose edges are mostly implied by lines: sequences of stops where an edge leads from the departure
+    // vertex of every stop to the arrival vertex of every later stop. Such edges are generated while they are
+    // read and are never stored, so a line of n stops takes O(n) memory instead of O(n^2) edges.
+    // The weight of an edge is the length between its stops divided by length_per_weight.
+    //
+    // Edge ids of the stored graph come first, then the ids of the lines in their order:
+    // the edge from the stop i to the stop j of a line of n stops has the id first_edge + i * n + j.
+    // The edges of a vertex are read in the order of ids, as the ones of a DirectedWeightedGraph
+    template <typename Weight>
+    class LineGraph {
+    public:
+        struct LineStop {
+            VertexId departure;
+            VertexId arrival;
+            int64_t length; // from the first stop of the line
+        };
+
+        struct Line {
+            uint32_t name_id; // given to the edges of the line
+            std::vector<LineStop> stops;
+        };
+
+        // the graph has to be frozen and must outlive this one
+        LineGraph(const DirectedWeightedGraph<Weight>& graph, std::vector<Line> lines, Weight length_per_weight);
+
+        size_t GetVertexCount() const {
+            return graph_.GetVertexCount();
+        }
+        Edge<Weight> GetEdge(EdgeId edge_id) const;
+        bool HasNegativeWeights() const {
+            return graph_.HasNegativeWeights();
+        }
+
+        // calls callback(to, weight, edge_id) for the edges leaving the vertex
+        template <typename Callback>
+        void ForEachOutgoingEdge(VertexId vertex, Callback callback) const;
+
+    private:
+        struct LineInfo {
+            uint32_t name_id;
+            size_t first_stop; // in stops_
+            size_t stop_count;
+            EdgeId first_edge;
+        };
+
+        // stop of a line where its edges start
+        struct Departure {
+            size_t line;
+            size_t position;
+        };
+
+        Weight GetWeight(const LineStop& from, const LineStop& to) const {
+            return static_cast<Weight>(to.length - from.length) / length_per_weight_;
+        }
+
+        const DirectedWeightedGraph<Weight>& graph_;
+        Weight length_per_weight_;
+        std::vector<LineInfo> lines_;
+        std::vector<LineStop> stops_;
+        // departures of a vertex v are [departure_offsets_[v], departure_offsets_[v + 1]), by line and position
+        std::vector<size_t> departure_offsets_;
+        std::vector<Departure> departures_;
+    };
+
+    template <typename Weight>
+    LineGraph<Weight>::LineGraph(const DirectedWeightedGraph<Weight>& graph, std::vector<Line> lines,
+        Weight length_per_weight)
+        : graph_(graph)
+        , length_per_weight_(length_per_weight)
+        , departure_offsets_(graph.GetVertexCount() + 1, 0)
+    {
+        if (!graph.IsFrozen()) {
+            throw std::invalid_argument("Graph is not frozen");
+        }
+        EdgeId first_edge = graph.GetEdgeCount();
+        lines_.reserve(lines.size());
+        for (const Line& line : lines) {
+            if (line.stops.empty()) {
+                continue;
+            }
+            for (size_t i = 0; i < line.stops.size(); ++i) {
+                const LineStop& stop = line.stops[i];
+                if (stop.departure >= graph.GetVertexCount() || stop.arrival >= graph.GetVertexCount()) {
+                    throw std::out_of_range("Vertex id is out of range");
+                }
+                if (i > 0 && stop.length < line.stops[i - 1].length) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                ++departure_offsets_[stop.departure + 1];
+            }
+            lines_.push_back({ line.name_id, stops_.size(), line.stops.size(), first_edge });
+            stops_.insert(stops_.end(), line.stops.begin(), line.stops.end());
+            first_edge += line.stops.size() * line.stops.size();
+        }
+
+        for (size_t vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+            departure_offsets_[vertex + 1] += departure_offsets_[vertex];
+        }
+        departures_.resize(stops_.size());
+        std::vector<size_t> positions(departure_offsets_.begin(), departure_offsets_.end() - 1);
+        for (size_t line = 0; line < lines_.size(); ++line) {
+            for (size_t position = 0; position < lines_[line].stop_count; ++position) {
+                departures_[positions[stops_[lines_[line].first_stop + position].departure]++] = { line, position };
+            }
+        }
+    }
+
+    template <typename Weight>
+    Edge<Weight> LineGraph<Weight>::GetEdge(EdgeId edge_id) const {
+        if (edge_id < graph_.GetEdgeCount()) {
+            return graph_.GetEdge(edge_id);
+        }
+        const auto it = std::upper_bound(lines_.begin(), lines_.end(), edge_id,
+            [](EdgeId id, const LineInfo& line) { return id < line.first_edge; });
+        if (it == lines_.begin()) {
+            throw std::out_of_range("Edge id is out of range");
+        }
+        const LineInfo& line = *std::prev(it);
+        const size_t from = (edge_id - line.first_edge) / line.stop_count;
+        const size_t to = (edge_id - line.first_edge) % line.stop_count;
+        if (from >= line.stop_count || to <= from) {
+            throw std::out_of_range("Edge id is out of range");
+        }
+        const LineStop& from_stop = stops_[line.first_stop + from];
+        const LineStop& to_stop = stops_[line.first_stop + to];
+        return { line.name_id, to - from, from_stop.departure, to_stop.arrival, GetWeight(from_stop, to_stop) };
+    }
+
+    template <typename Weight>
+    template <typename Callback>
+    void LineGraph<Weight>::ForEachOutgoingEdge(VertexId vertex, Callback callback) const {
+        graph_.ForEachOutgoingEdge(vertex, callback);
+        for (size_t i = departure_offsets_[vertex]; i < departure_offsets_[vertex + 1]; ++i) {
+            const LineInfo& line = lines_[departures_[i].line];
+            const size_t from = departures_[i].position;
+            const LineStop* stops = &stops_[line.first_stop];
+            const EdgeId first_edge = line.first_edge + from * line.stop_count;
+            for (size_t to = from + 1; to < line.stop_count; ++to) {
+                callback(stops[to].arrival, GetWeight(stops[from], stops[to]), first_edge + to);
+            }
+        }
+    }
+
+}  // namespace graph
@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t size = 0;
+};
+
+// bounded cache that drops the least recently used values. Keys are spread over shards by their hash,
+// every shard has its own lock, order and part of the capacity, so that threads rarely wait for each other
+template <typename Key, typename Value, typename Hasher = std::hash<Key>>
+class ShardedLruCache {
+public:
+    using Stats = CacheStats;
+
+    // capacity 0 disables the cache
+    explicit ShardedLruCache(size_t capacity = 0, size_t shard_count = 16) {
+        Reset(capacity, shard_count);
+    }
+
+    // drops the values and the counters
+    void Reset(size_t capacity, size_t shard_count) {
+        shard_count = capacity == 0 ? 0 : std::max<size_t>(1, std::min(shard_count, capacity));
+        shards_ = std::vector<Shard>(shard_count);
+        for (Shard& shard : shards_) {
+            shard.capacity = (capacity + shard_count - 1) / shard_count;
+        }
+    }
+
+    size_t GetCapacity() const {
+        return shards_.empty() ? 0 : shards_.size() * shards_.front().capacity;
+    }
+
+    std::optional<Value> Find(const Key& key) {
+        if (shards_.empty()) {
+            return std::nullopt;
+        }
+        Shard& shard = GetShard(key);
+        std::lock_guard lock(shard.mutex);
+        const auto it = shard.positions.find(key);
+        if (it == shard.positions.end()) {
+            ++shard.stats.misses;
+            return std::nullopt;
+        }
+        ++shard.stats.hits;
+        shard.order.splice(shard.order.begin(), shard.order, it->second);
+        return it->second->second;
+    }
+
+    void Insert(const Key& key, Value value) {
+        if (shards_.empty()) {
+            return;
+        }
+        Shard& shard = GetShard(key);
+        std::lock_guard lock(shard.mutex);
+        if (const auto it = shard.positions.find(key); it != shard.positions.end()) {
+            it->second->second = std::move(value);
+            shard.order.splice(shard.order.begin(), shard.order, it->second);
+            return;
+        }
+        if (shard.order.size() >= shard.capacity) {
+            shard.positions.erase(shard.order.back().first);
+            shard.order.pop_back();
+            ++shard.stats.evictions;
+        }
+        shard.order.emplace_front(key, std::move(value));
+        shard.positions.emplace(key, shard.order.begin());
+    }
+
+    // drops the values, the counters stay
+    void Clear() {
+        for (Shard& shard : shards_) {
+            std::lock_guard lock(shard.mutex);
+            shard.order.clear();
+            shard.positions.clear();
+        }
+    }
+
+    Stats GetStats() const {
+        Stats stats;
+        for (const Shard& shard : shards_) {
+            std::lock_guard lock(shard.mutex);
+            stats.hits += shard.stats.hits;
+            stats.misses += shard.stats.misses;
+            stats.evictions += shard.stats.evictions;
+            stats.size += shard.order.size();
+        }
+        return stats;
+    }
+
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        size_t capacity = 0;
+        std::list<std::pair<Key, Value>> order; // most recently used first
+        std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hasher> positions;
+        Stats stats;
+    };
+
+    Shard& GetShard(const Key& key) {
+        return shards_[Hasher{}(key) % shards_.size()];
+    }
+
+    std::vector<Shard> shards_;
+};
@@ -1,5 +1,6 @@
 ﻿#include <iostream>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <set>
 
@@ -9,10 +10,28 @@
 
 using namespace std;
 
-int main() {
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+}
+
+// make_base saves the catalogue made from base_requests, process_requests answers stat_requests
+// with the saved one and ignores base_requests; without a mode one input does both
+int main(int argc, char* argv[]) {
     //ifstream input("in.txt"s);
 
-    JsonReader json_doc(std::cin);
+    const std::string_view mode = argc > 1 ? std::string_view(argv[1]) : std::string_view();
+    if (argc > 2 || (argc == 2 && mode != "make_base"sv && mode != "process_requests"sv)) {
+        PrintUsage();
+        return 1;
+    }
+
+    JsonReader json_doc(std::cin, mode == "make_base"sv ? RunMode::MAKE_BASE
+        : mode == "process_requests"sv ? RunMode::PROCESS_REQUESTS : RunMode::DIRECT);
 
-    json_doc.PrintToStream(std::cout);
-}
\ No newline at end of file
+    if (mode == "make_base"sv) {
+        json_doc.SaveCatalogue();
+    }
+    else {
+        json_doc.PrintToStream(std::cout);
+    }
+}
@@ -3,8 +3,8 @@
 using namespace std::literals;
 
 void MapRenderer::SetBusUnderlayerSettings(svg::Text* bus_label_underlayer, const transport_catalogue::Bus* bus, int stop_num) {
-    bus_label_underlayer->SetData(bus->route_name)
-        .SetPosition(proj_(bus->route.at(stop_num)->coordinates))
+    bus_label_underlayer->SetData(std::string(bus->route_name))
+        .SetPosition(proj_(catalogue_->GetStop(bus->route[stop_num]).coordinates))
         .SetOffset(render_settings_.bus_label_offset)
         .SetFontSize(render_settings_.bus_label_font_size)
         .SetFontFamily("Verdana"s)
@@ -17,8 +17,8 @@ void MapRenderer::SetBusUnderlayerSettings(svg::Text* bus_label_underlayer, cons
 }
 
 void MapRenderer::SetBusLabelSettings(svg::Text* bus_label, const transport_catalogue::Bus* bus, int stop_num, int palette_count) {
-    bus_label->SetData(bus->route_name)
-        .SetPosition(proj_(bus->route.at(stop_num)->coordinates))
+    bus_label->SetData(std::string(bus->route_name))
+        .SetPosition(proj_(catalogue_->GetStop(bus->route[stop_num]).coordinates))
         .SetOffset(render_settings_.bus_label_offset)
         .SetFontSize(render_settings_.bus_label_font_size)
         .SetFontFamily("Verdana"s)
@@ -27,7 +27,7 @@ void MapRenderer::SetBusLabelSettings(svg::Text* bus_label, const transport_cata
 }
 
 void MapRenderer::SetStopUnderlayerSettings(svg::Text* stop_label_underlayer, const transport_catalogue::Stop* stop) {
-    stop_label_underlayer->SetData(stop->name)
+    stop_label_underlayer->SetData(std::string(stop->name))
         .SetPosition(proj_(stop->coordinates))
         .SetOffset(render_settings_.stop_label_offset)
         .SetFontSize(render_settings_.stop_label_font_size)
@@ -40,7 +40,7 @@ void MapRenderer::SetStopUnderlayerSettings(svg::Text* stop_label_underlayer, co
 }
 
 void MapRenderer::SetStopLabelSettings(svg::Text * stop_label, const transport_catalogue::Stop * stop) {
-    stop_label->SetData(stop->name)
+    stop_label->SetData(std::string(stop->name))
         .SetPosition(proj_(stop->coordinates))
         .SetOffset(render_settings_.stop_label_offset)
         .SetFontSize(render_settings_.stop_label_font_size)
@@ -111,9 +111,9 @@ RenderSettings MapRenderer::SetRenderSettings(const json::Dict& dict) {
     return sets;
 }
 
-void MapRenderer::AddRouteLines(const std::vector<const transport_catalogue::Bus*>* sorted_buses, int palette_count, int colours_num) {
-    for (const transport_catalogue::Bus* bus : *sorted_buses) {
-        if (!bus->route.empty()) {
+void MapRenderer::AddRouteLines(const std::vector<transport_catalogue::Bus>* sorted_buses, int palette_count, int colours_num) {
+    for (const transport_catalogue::Bus& bus : *sorted_buses) {
+        if (!bus.route.empty()) {
             svg::Polyline route_line;
             route_line.SetFillColor("none"s)
                 .SetStrokeColor(render_settings_.color_palette[palette_count])
@@ -124,32 +124,32 @@ void MapRenderer::AddRouteLines(const std::vector<const transport_catalogue::Bus
             ++palette_count;
             if (palette_count == colours_num) palette_count = 0;
 
-            for (const transport_catalogue::Stop* stop : bus->route) {
-                route_line.AddPoint(proj_(stop->coordinates));
+            for (const transport_catalogue::StopId stop : bus.route) {
+                route_line.AddPoint(proj_(catalogue_->GetStop(stop).coordinates));
             }
             svg_doc_.Add(std::move(route_line));
         }
     }
 }
 
-void MapRenderer::AddBusesLabels(const std::vector<const transport_catalogue::Bus*>* sorted_buses, int palette_count, int colours_num) {
-    for (const transport_catalogue::Bus* bus : *sorted_buses) {
-        if (!bus->route.empty()) {
+void MapRenderer::AddBusesLabels(const std::vector<transport_catalogue::Bus>* sorted_buses, int palette_count, int colours_num) {
+    for (const transport_catalogue::Bus& bus : *sorted_buses) {
+        if (!bus.route.empty()) {
             svg::Text bus_label_underlayer;
-            SetBusUnderlayerSettings(&bus_label_underlayer, bus, 0);
+            SetBusUnderlayerSettings(&bus_label_underlayer, &bus, 0);
             svg_doc_.Add(std::move(bus_label_underlayer));
 
             svg::Text bus_label;
-            SetBusLabelSettings(&bus_label, bus, 0, palette_count);
+            SetBusLabelSettings(&bus_label, &bus, 0, palette_count);
             svg_doc_.Add(std::move(bus_label));
 
-            if (int second_stop_index = bus->route.size() / 2; !bus->is_roundtrip && bus->route.at(second_stop_index)->name != bus->route.at(0)->name) {
+            if (int second_stop_index = bus.route.size() / 2; !bus.is_roundtrip && bus.route[second_stop_index] != bus.route[0]) {
                 svg::Text bus_second_label_underlayer;
-                SetBusUnderlayerSettings(&bus_second_label_underlayer, bus, second_stop_index);
+                SetBusUnderlayerSettings(&bus_second_label_underlayer, &bus, second_stop_index);
                 svg_doc_.Add(std::move(bus_second_label_underlayer));
 
                 svg::Text bus_second_label;
-                SetBusLabelSettings(&bus_second_label, bus, second_stop_index, palette_count);
+                SetBusLabelSettings(&bus_second_label, &bus, second_stop_index, palette_count);
                 svg_doc_.Add(std::move(bus_second_label));
 
             }
@@ -159,11 +159,11 @@ void MapRenderer::AddBusesLabels(const std::vector<const transport_catalogue::Bu
     }
 }
 
-void MapRenderer::AddStopsSymbols(const std::vector<const transport_catalogue::Stop*>* all_sorted_stops) {
+void MapRenderer::AddStopsSymbols(const std::vector<transport_catalogue::Stop>* all_sorted_stops) {
 
-    for (const transport_catalogue::Stop* stop : *all_sorted_stops) {
+    for (const transport_catalogue::Stop& stop : *all_sorted_stops) {
         svg::Circle stop_symbol;
-        stop_symbol.SetCenter(proj_(stop->coordinates))
+        stop_symbol.SetCenter(proj_(stop.coordinates))
             .SetRadius(render_settings_.stop_radius)
             .SetFillColor("white"s);
 
@@ -171,28 +171,28 @@ void MapRenderer::AddStopsSymbols(const std::vector<const transport_catalogue::S
     }
 }
 
-void MapRenderer::AddStopLabels(const std::vector<const transport_catalogue::Stop*>* all_sorted_stops) {
-    for (const transport_catalogue::Stop* stop : *all_sorted_stops) {
+void MapRenderer::AddStopLabels(const std::vector<transport_catalogue::Stop>* all_sorted_stops) {
+    for (const transport_catalogue::Stop& stop : *all_sorted_stops) {
         svg::Text stop_label_underlayer;
-        SetStopUnderlayerSettings(&stop_label_underlayer, stop);
+        SetStopUnderlayerSettings(&stop_label_underlayer, &stop);
 
         svg_doc_.Add(std::move(stop_label_underlayer));
 
         svg::Text stop_label;
-        SetStopLabelSettings(&stop_label, stop);
+        SetStopLabelSettings(&stop_label, &stop);
 
         svg_doc_.Add(std::move(stop_label));
     }
 }
 
 MapRenderer& MapRenderer::CreateMap() {
-    const std::vector<const transport_catalogue::Bus*> sorted_buses = catalogue_->GetBusCatalogue();
+    const std::vector<transport_catalogue::Bus> sorted_buses = catalogue_->GetBusCatalogue();
 
     {
         std::vector<geo::Coordinates> all_stops_coords;
-        for (const transport_catalogue::Bus* bus : sorted_buses) {
-            for (const transport_catalogue::Stop* stop : bus->route) {
-                all_stops_coords.push_back(stop->coordinates);
+        for (const transport_catalogue::Bus& bus : sorted_buses) {
+            for (const transport_catalogue::StopId stop : bus.route) {
+                all_stops_coords.push_back(catalogue_->GetStop(stop).coordinates);
             }
         }
 
@@ -211,7 +211,7 @@ MapRenderer& MapRenderer::CreateMap() {
     AddBusesLabels(&sorted_buses, palette_count, colours_num);
 
     // stops' symbols
-    std::vector<const transport_catalogue::Stop*> all_sorted_stops = catalogue_->GetStopCatalogue();
+    std::vector<transport_catalogue::Stop> all_sorted_stops = catalogue_->GetStopCatalogue();
 
     AddStopsSymbols(&all_sorted_stops);
 
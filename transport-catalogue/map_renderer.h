@@ -146,12 +146,12 @@ private:
 
     RenderSettings SetRenderSettings(const json::Dict& dict);
 
-    void AddRouteLines(const std::vector<const transport_catalogue::Bus*>* sorted_buses, int palette_count, int colours_num);
+    void AddRouteLines(const std::vector<transport_catalogue::Bus>* sorted_buses, int palette_count, int colours_num);
 
-    void AddBusesLabels(const std::vector<const transport_catalogue::Bus*>* sorted_buses, int palette_count, int colours_num);
+    void AddBusesLabels(const std::vector<transport_catalogue::Bus>* sorted_buses, int palette_count, int colours_num);
 
-    void AddStopsSymbols(const std::vector<const transport_catalogue::Stop*>* all_sorted_stops);
+    void AddStopsSymbols(const std::vector<transport_catalogue::Stop>* all_sorted_stops);
 
-    void AddStopLabels(const std::vector<const transport_catalogue::Stop*>* all_sorted_stops);
+    void AddStopLabels(const std::vector<transport_catalogue::Stop>* all_sorted_stops);
 
 };
\ No newline at end of file
@@ -0,0 +1,185 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+    // ids by names. While names are added it is an open-addressing table; Freeze replaces it with
+    // a minimal perfect hash over the names: the hash of a name and the seed of its bucket give the only
+    // entry it can be in, so a lookup is one probe and one comparison
+    class NameIndex {
+    public:
+        // the name has to outlive the index, a name added again gets the new id
+        void Add(std::string_view name, uint32_t id) {
+            if (is_frozen_) {
+                throw std::logic_error("Name index is frozen");
+            }
+            if ((entries_.size() + 1) * 2 > slots_.size()) {
+                Rehash(slots_.empty() ? 16 : slots_.size() * 2);
+            }
+            const size_t hash = Hash(name);
+            size_t i = hash & (slots_.size() - 1);
+            for (; slots_[i] != 0; i = (i + 1) & (slots_.size() - 1)) {
+                Entry& entry = entries_[slots_[i] - 1];
+                if (entry.name == name) {
+                    entry.id = id;
+                    return;
+                }
+            }
+            slots_[i] = static_cast<uint32_t>(entries_.size() + 1);
+            entries_.push_back({ name, id });
+            hashes_.push_back(hash);
+        }
+
+        std::optional<uint32_t> Find(std::string_view name) const {
+            if (entries_.empty()) {
+                return std::nullopt;
+            }
+            const size_t hash = Hash(name);
+            if (is_frozen_) {
+                const Entry& entry = entries_[GetSlot(hash, seeds_[hash % seeds_.size()])];
+                return entry.name == name ? std::optional<uint32_t>(entry.id) : std::nullopt;
+            }
+            for (size_t i = hash & (slots_.size() - 1); slots_[i] != 0; i = (i + 1) & (slots_.size() - 1)) {
+                const Entry& entry = entries_[slots_[i] - 1];
+                if (entry.name == name) {
+                    return entry.id;
+                }
+            }
+            return std::nullopt;
+        }
+
+        size_t GetSize() const {
+            return entries_.size();
+        }
+
+        // builds the perfect hash, nothing can be added after
+        void Freeze();
+
+    private:
+        struct Entry {
+            std::string_view name;
+            uint32_t id;
+        };
+
+        // names per bucket of the perfect hash on average
+        static constexpr size_t BUCKET_SIZE = 2;
+        static constexpr uint32_t MAX_SEED = 1u << 24;
+
+        static size_t Hash(std::string_view name) {
+            return std::hash<std::string_view>{}(name);
+        }
+
+        // entry of a name with the hash in a bucket with the seed
+        size_t GetSlot(size_t hash, uint32_t seed) const {
+            uint64_t x = (static_cast<uint64_t>(hash) ^ (seed * 0x9E3779B97F4A7C15ull)) + seed;
+            x = (x ^ (x >> 33)) * 0xFF51AFD7ED558CCDull;
+            x = (x ^ (x >> 33)) * 0xC4CEB9FE1A85EC53ull;
+            x ^= x >> 33;
+            return static_cast<size_t>(x % entries_.size());
+        }
+
+        // capacity is a power of two
+        void Rehash(size_t capacity) {
+            slots_.assign(capacity, 0);
+            for (size_t entry = 0; entry < entries_.size(); ++entry) {
+                size_t i = hashes_[entry] & (capacity - 1);
+                while (slots_[i] != 0) {
+                    i = (i + 1) & (capacity - 1);
+                }
+                slots_[i] = static_cast<uint32_t>(entry + 1);
+            }
+        }
+
+        std::vector<Entry> entries_; // by the slot of the perfect hash once frozen
+        bool is_frozen_ = false;
+
+        // while adding: the open-addressing table of entry numbers + 1, 0 for the free slots, and the entry hashes
+        std::vector<uint32_t> slots_;
+        std::vector<size_t> hashes_;
+
+        std::vector<uint32_t> seeds_; // by the bucket, once frozen
+    };
+
+    inline void NameIndex::Freeze() {
+        if (is_frozen_) {
+            return;
+        }
+        is_frozen_ = true;
+        const size_t entry_count = entries_.size();
+        if (entry_count == 0) {
+            slots_ = {};
+            hashes_ = {};
+            return;
+        }
+        seeds_.assign((entry_count + BUCKET_SIZE - 1) / BUCKET_SIZE, 0);
+
+        // entries by the bucket, the buckets placed from the largest one, while there is much room
+        std::vector<size_t> bucket_offsets(seeds_.size() + 1, 0);
+        for (const size_t hash : hashes_) {
+            ++bucket_offsets[hash % seeds_.size() + 1];
+        }
+        for (size_t bucket = 0; bucket < seeds_.size(); ++bucket) {
+            bucket_offsets[bucket + 1] += bucket_offsets[bucket];
+        }
+        std::vector<uint32_t> bucket_entries(entry_count);
+        {
+            std::vector<size_t> positions(bucket_offsets.begin(), bucket_offsets.end() - 1);
+            for (size_t entry = 0; entry < entry_count; ++entry) {
+                bucket_entries[positions[hashes_[entry] % seeds_.size()]++] = static_cast<uint32_t>(entry);
+            }
+        }
+        std::vector<uint32_t> buckets(seeds_.size());
+        for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+            buckets[bucket] = static_cast<uint32_t>(bucket);
+        }
+        std::stable_sort(buckets.begin(), buckets.end(), [&bucket_offsets](uint32_t lhs, uint32_t rhs) {
+            return bucket_offsets[lhs + 1] - bucket_offsets[lhs] > bucket_offsets[rhs + 1] - bucket_offsets[rhs];
+        });
+
+        // the first seed that puts all the entries of the bucket into free slots, different ones
+        std::vector<bool> is_taken(entry_count, false);
+        std::vector<size_t> slots;
+        std::vector<Entry> placed(entry_count);
+        for (const uint32_t bucket : buckets) {
+            const size_t begin = bucket_offsets[bucket];
+            const size_t end = bucket_offsets[bucket + 1];
+            if (begin == end) {
+                continue;
+            }
+            for (uint32_t seed = 0;; ++seed) {
+                if (seed == MAX_SEED) {
+                    // only names with equal hashes get here
+                    throw std::runtime_error("Cannot build the perfect hash of the names");
+                }
+                slots.clear();
+                for (size_t i = begin; i < end; ++i) {
+                    const size_t slot = GetSlot(hashes_[bucket_entries[i]], seed);
+                    if (is_taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if (slots.size() == end - begin) {
+                    seeds_[bucket] = seed;
+                    break;
+                }
+            }
+            for (size_t i = begin; i < end; ++i) {
+                is_taken[slots[i - begin]] = true;
+                placed[slots[i - begin]] = entries_[bucket_entries[i]];
+            }
+        }
+        entries_ = std::move(placed);
+        slots_ = {};
+        hashes_ = {};
+    }
+
+}  // namespace transport_catalogue
@@ -22,6 +22,16 @@ namespace ranges {
         It end() const {
             return end_;
         }
+        size_t size() const {
+            return std::distance(begin_, end_);
+        }
+        bool empty() const {
+            return begin_ == end_;
+        }
+        // random access iterators only
+        decltype(auto) operator[](size_t index) const {
+            return begin_[index];
+        }
 
     private:
         It begin_;
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // vertices reachable from "from" by routes not heavier than max_weight, with the weights of the lightest
+    // routes, in the order of growing weight. The Dijkstra search stops as soon as the lightest queued weight
+    // exceeds max_weight, so only the vertices inside the budget and their neighbours are ever touched.
+    // The graph has to be frozen, Graph may also be a LineGraph
+    template <typename Weight, typename Graph = DirectedWeightedGraph<Weight>>
+    std::vector<std::pair<VertexId, Weight>> FindReachableVertices(const Graph& graph, VertexId from, Weight max_weight) {
+        if (from >= graph.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+
+        struct QueueItem {
+            Weight weight;
+            VertexId vertex;
+
+            bool operator>(const QueueItem& other) const {
+                return weight > other.weight || (weight == other.weight && vertex > other.vertex);
+            }
+        };
+        const auto greater = [](const QueueItem& lhs, const QueueItem& rhs) { return lhs > rhs; };
+        constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+            ? std::numeric_limits<Weight>::infinity()
+            : std::numeric_limits<Weight>::max();
+
+        std::vector<std::pair<VertexId, Weight>> reachable;
+        std::vector<Weight> weights(graph.GetVertexCount(), INFINITE_WEIGHT);
+        std::vector<bool> settled(graph.GetVertexCount(), false);
+        std::vector<QueueItem> queue{ { Weight{}, from } };
+        weights[from] = Weight{};
+
+        while (!queue.empty()) {
+            std::pop_heap(queue.begin(), queue.end(), greater);
+            const QueueItem item = queue.back();
+            queue.pop_back();
+            if (item.weight > max_weight) {
+                break;
+            }
+            if (settled[item.vertex]) {
+                continue; // outdated queue entry
+            }
+            settled[item.vertex] = true;
+            reachable.emplace_back(item.vertex, item.weight);
+
+            graph.ForEachOutgoingEdge(item.vertex, [&](VertexId next, Weight edge_weight, EdgeId) {
+                if (edge_weight < Weight{}) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                const Weight candidate_weight = item.weight + edge_weight;
+                if (candidate_weight < weights[next] && !(candidate_weight > max_weight)) {
+                    weights[next] = candidate_weight;
+                    queue.push_back({ candidate_weight, next });
+                    std::push_heap(queue.begin(), queue.end(), greater);
+                }
+            });
+        }
+        return reachable;
+    }
+
+}  // namespace graph
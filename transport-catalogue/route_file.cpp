@@ -0,0 +1,260 @@
+﻿#include "route_file.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ROUTE_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std::literals;
+
+namespace route_file {
+
+    namespace {
+        const char FILE_MAGIC[8] = { 'T', 'C', 'R', 'O', 'U', 'T', 'E', 'S' };
+        const uint32_t FILE_VERSION = 3;
+        const uint64_t HASH_PRIME = 1099511628211ull;
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t weight_size;
+            uint64_t key;
+            uint64_t vertex_count;
+            uint64_t edge_count;
+            uint64_t checksum; // of the edges and the row checksums, the rows are checked when they are used
+        };
+
+        struct EdgeRecord {
+            uint64_t from;
+            uint64_t to;
+            uint64_t span_count;
+            double weight;
+            uint64_t name_id;
+        };
+
+        // sections follow the header in this order, each one starts at a multiple of 8 bytes
+        struct FileLayout {
+            size_t edges_offset;
+            size_t row_checksums_offset;
+            size_t weights_offset;
+            size_t prev_edges_offset;
+            size_t size;
+        };
+
+        size_t AlignUp(size_t size) {
+            return (size + 7) / 8 * 8;
+        }
+
+        FileLayout ComputeLayout(const FileHeader& header) {
+            const size_t cell_count = header.vertex_count * header.vertex_count;
+            FileLayout layout;
+            layout.edges_offset = sizeof(FileHeader);
+            layout.row_checksums_offset = AlignUp(layout.edges_offset + header.edge_count * sizeof(EdgeRecord));
+            layout.weights_offset = layout.row_checksums_offset + header.vertex_count * sizeof(uint64_t);
+            layout.prev_edges_offset = AlignUp(layout.weights_offset + cell_count * header.weight_size);
+            layout.size = layout.prev_edges_offset + cell_count * sizeof(uint32_t);
+            return layout;
+        }
+
+        // sizes of the sections and of the padding after them in file order
+        std::vector<size_t> ComputeSectionSizes(const FileHeader& header, const FileLayout& layout) {
+            const size_t weights_size = header.vertex_count * header.vertex_count * header.weight_size;
+            return {
+                layout.row_checksums_offset - layout.edges_offset,
+                layout.weights_offset - layout.row_checksums_offset,
+                weights_size,
+                layout.prev_edges_offset - layout.weights_offset - weights_size,
+                layout.size - layout.prev_edges_offset,
+            };
+        }
+
+        uint64_t ComputeRowHash(const char* weights, size_t weight_size, const uint32_t* prev_edges,
+            size_t vertex_count, graph::VertexId row) {
+            const size_t row_offset = static_cast<size_t>(row) * vertex_count;
+            const uint64_t hash = ComputeHash(weights + row_offset * weight_size, vertex_count * weight_size);
+            return ComputeHash(prev_edges + row_offset, vertex_count * sizeof(uint32_t), hash);
+        }
+    }
+
+#ifdef ROUTE_FILE_MMAP
+    MappedFile::MappedFile(const std::string& path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open "s + path);
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+            throw std::runtime_error("Cannot read "s + path);
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ > 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Cannot map "s + path);
+            }
+            data_ = static_cast<const char*>(data);
+        }
+        close(fd); // the mapping stays valid
+    }
+
+    MappedFile::~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+#else
+    MappedFile::MappedFile(const std::string& path) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            throw std::runtime_error("Cannot open "s + path);
+        }
+        buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+
+    MappedFile::~MappedFile() = default;
+#endif
+
+    // FNV-1a over 8-byte words, the tail is taken byte by byte
+    uint64_t ComputeHash(const void* data, size_t size, uint64_t hash) {
+        const char* bytes = static_cast<const char*>(data);
+        size_t position = 0;
+        for (; position + sizeof(uint64_t) <= size; position += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, bytes + position, sizeof(word));
+            hash = (hash ^ word) * HASH_PRIME;
+        }
+        for (; position < size; ++position) {
+            hash = (hash ^ static_cast<unsigned char>(bytes[position])) * HASH_PRIME;
+        }
+        return hash;
+    }
+
+    void SaveRoutes(const std::string& path, uint64_t key, const graph::DirectedWeightedGraph<double>& graph,
+        const void* weights, size_t weight_size, const uint32_t* prev_edges) {
+        std::vector<EdgeRecord> edges;
+        edges.reserve(graph.GetEdgeCount());
+        for (graph::EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            edges.push_back({ edge.from, edge.to, edge.span_count, edge.weight, edge.name_id });
+        }
+
+        FileHeader header{};
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header.version = FILE_VERSION;
+        header.weight_size = static_cast<uint32_t>(weight_size);
+        header.key = key;
+        header.vertex_count = graph.GetVertexCount();
+        header.edge_count = edges.size();
+        std::vector<uint64_t> row_checksums(graph.GetVertexCount());
+        for (graph::VertexId row = 0; row < row_checksums.size(); ++row) {
+            row_checksums[row] = ComputeRowHash(static_cast<const char*>(weights), weight_size, prev_edges,
+                row_checksums.size(), row);
+        }
+        const std::vector<size_t> section_sizes = ComputeSectionSizes(header, ComputeLayout(header));
+        const char padding[8] = {};
+        const void* const sections[] = { edges.data(), row_checksums.data(), weights, padding, prev_edges };
+        header.checksum = ComputeHash(nullptr, 0);
+        for (size_t i = 0; i < 2; ++i) {
+            header.checksum = ComputeHash(sections[i], section_sizes[i], header.checksum);
+        }
+
+        const std::string temporary_path = path + ".tmp"s;
+        std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (size_t i = 0; i < section_sizes.size(); ++i) {
+            output.write(static_cast<const char*>(sections[i]), section_sizes[i]);
+        }
+        output.close();
+        std::error_code error;
+        if (output) {
+            std::filesystem::rename(temporary_path, path, error);
+        }
+        if (!output || error) {
+            std::filesystem::remove(temporary_path, error);
+            throw std::runtime_error("Cannot write "s + path);
+        }
+    }
+
+    std::optional<LoadedRoutes> LoadRoutes(const std::string& path, uint64_t key, size_t weight_size) {
+        std::error_code error;
+        if (!std::filesystem::exists(path, error)) {
+            return std::nullopt;
+        }
+        std::unique_ptr<MappedFile> file;
+        try {
+            file = std::make_unique<MappedFile>(path);
+        }
+        catch (const std::runtime_error&) {
+            return std::nullopt; // unreadable, rebuilt and written anew like a damaged one
+        }
+        const char* data = file->GetData();
+
+        FileHeader header;
+        if (file->GetSize() < sizeof(header)) {
+            return std::nullopt;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION
+            || header.weight_size != weight_size || header.key != key
+            || (header.vertex_count > 0 && header.vertex_count > file->GetSize() / header.vertex_count)
+            || header.edge_count > file->GetSize() / sizeof(EdgeRecord)) {
+            return std::nullopt;
+        }
+        const FileLayout layout = ComputeLayout(header);
+        if (layout.size != file->GetSize()) {
+            return std::nullopt;
+        }
+        if (ComputeHash(data + layout.edges_offset, layout.weights_offset - layout.edges_offset) != header.checksum) {
+            return std::nullopt;
+        }
+
+        graph::DirectedWeightedGraph<double> graph(header.vertex_count);
+        for (size_t i = 0; i < header.edge_count; ++i) {
+            EdgeRecord edge;
+            std::memcpy(&edge, data + layout.edges_offset + i * sizeof(EdgeRecord), sizeof(edge));
+            if (edge.from >= header.vertex_count || edge.to >= header.vertex_count
+                || edge.name_id > std::numeric_limits<uint32_t>::max()) {
+                return std::nullopt;
+            }
+            graph.AddEdge({ static_cast<uint32_t>(edge.name_id), edge.span_count, edge.from, edge.to, edge.weight });
+        }
+
+        const void* weights = data + layout.weights_offset;
+        const uint32_t* prev_edges = reinterpret_cast<const uint32_t*>(data + layout.prev_edges_offset);
+        const uint64_t* row_checksums = reinterpret_cast<const uint64_t*>(data + layout.row_checksums_offset);
+        return LoadedRoutes{ std::move(file), std::move(graph), weights, prev_edges, row_checksums };
+    }
+
+    TableRowChecker::TableRowChecker(const LoadedRoutes& routes, size_t weight_size)
+        : weights_(static_cast<const char*>(routes.weights))
+        , prev_edges_(routes.prev_edges)
+        , row_checksums_(routes.row_checksums)
+        , vertex_count_(routes.graph.GetVertexCount())
+        , weight_size_(weight_size)
+        , row_states_(vertex_count_, RowState::UNCHECKED) {
+    }
+
+    bool TableRowChecker::CheckRow(graph::VertexId row) const {
+        if (row_states_[row] == RowState::UNCHECKED) {
+            row_states_[row] = ComputeRowHash(weights_, weight_size_, prev_edges_, vertex_count_, row) == row_checksums_[row]
+                ? RowState::VALID : RowState::DAMAGED;
+        }
+        return row_states_[row] == RowState::VALID;
+    }
+
+}  // namespace route_file
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include "graph.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace route_file {
+
+    // read-only view of a whole file, mapped into memory where the system allows it
+    class MappedFile {
+    public:
+        // throws std::runtime_error if the file cannot be opened
+        explicit MappedFile(const std::string& path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        const char* GetData() const {
+            return data_;
+        }
+        size_t GetSize() const {
+            return size_;
+        }
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        std::vector<char> buffer_; // the file contents where mmap is not available
+    };
+
+    // graph and all-pairs route table stored by SaveRoutes, the table stays in the mapped pages
+    struct LoadedRoutes {
+        std::unique_ptr<MappedFile> file;
+        graph::DirectedWeightedGraph<double> graph;
+        const void* weights;           // vertex_count * vertex_count values of weight_size bytes
+        const uint32_t* prev_edges;    // vertex_count * vertex_count ids
+        const uint64_t* row_checksums; // vertex_count checksums, each of a row of weights and of prev_edges
+    };
+
+    uint64_t ComputeHash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+    // LoadRoutes checks the graph and the row checksums only, so that the table is read when it is used.
+    // A row is checked the first time it is asked for, a route from a vertex reads the row of that vertex only.
+    // Not thread-safe, like the routers
+    class TableRowChecker {
+    public:
+        TableRowChecker(const LoadedRoutes& routes, size_t weight_size);
+
+        // false if the row does not match its checksum
+        bool CheckRow(graph::VertexId row) const;
+
+    private:
+        enum class RowState : uint8_t {
+            UNCHECKED,
+            VALID,
+            DAMAGED,
+        };
+
+        const char* weights_;
+        const uint32_t* prev_edges_;
+        const uint64_t* row_checksums_;
+        size_t vertex_count_;
+        size_t weight_size_;
+        mutable std::vector<RowState> row_states_;
+    };
+
+    // writes the file through a temporary one, so that a failed run never leaves a half-written file.
+    // Throws std::runtime_error on I/O errors, after removing the temporary file
+    void SaveRoutes(const std::string& path, uint64_t key, const graph::DirectedWeightedGraph<double>& graph,
+        const void* weights, size_t weight_size, const uint32_t* prev_edges);
+
+    // std::nullopt if there is no file or it cannot be read, if it was saved with another key, format version
+    // or weight size, or if it is damaged
+    std::optional<LoadedRoutes> LoadRoutes(const std::string& path, uint64_t key, size_t weight_size);
+
+}  // namespace route_file
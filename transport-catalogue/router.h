@@ -4,114 +4,259 @@
 
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
 #include <iterator>
+#include <limits>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+    // common interface of the routing engines, so that they can be selected at runtime
     template <typename Weight>
-    class Router {
-    private:
-        using Graph = DirectedWeightedGraph<Weight>;
-
+    class RouterBase {
     public:
-        explicit Router(const Graph& graph);
-
         struct RouteInfo {
             Weight weight;
             std::vector<EdgeId> edges;
         };
 
-        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+        virtual ~RouterBase() = default;
 
+        virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+        // weight of the route without collecting its edges
+        virtual std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const {
+            const std::optional<RouteInfo> route = BuildRoute(from, to);
+            return route ? std::optional<Weight>(route->weight) : std::nullopt;
+        }
+
+        // vertices settled by the last BuildRoute call, 0 for the routers that do not search
+        virtual size_t GetSettledVertexCount() const {
+            return 0;
+        }
+    };
+
+    // precomputes all-pairs routes (Floyd-Warshall), every query is a table walk.
+    // Rows of every Floyd-Warshall phase are relaxed by thread_count threads, the result does not
+    // depend on their number: a phase only reads the row and the column of its pivot, which it never changes.
+    // The table is stored row by row in two flat arrays: weights (TableWeight may be float to halve them)
+    // and 32-bit ids of the last edges of the routes. Missing routes are marked by sentinel values.
+    // A table built before (e.g. mapped from a file) can be used as it is, without a copy.
+    // The graph has to be frozen
+    template <typename Weight, typename TableWeight = Weight>
+    class Router final : public RouterBase<Weight> {
     private:
-        struct RouteInternalData {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
-        };
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using typename RouterBase<Weight>::RouteInfo;
 
+        explicit Router(const Graph& graph, size_t thread_count = 1);
+        // the arrays of vertex_count * vertex_count values must outlive the router
+        Router(const Graph& graph, const TableWeight* weights, const uint32_t* prev_edges);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const override {
+            if (from >= vertex_count_ || to >= vertex_count_) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            const TableWeight weight = table_weights_[from * vertex_count_ + to];
+            return weight == INFINITE_WEIGHT ? std::nullopt : std::optional<Weight>(static_cast<Weight>(weight));
+        }
+
+        // bytes taken by the route table
+        size_t GetTableSize() const {
+            return vertex_count_ * vertex_count_ * (sizeof(TableWeight) + sizeof(uint32_t));
+        }
+        const TableWeight* GetTableWeights() const {
+            return table_weights_;
+        }
+        const uint32_t* GetTablePrevEdges() const {
+            return table_prev_edges_;
+        }
+
+    private:
         void InitializeRoutesInternalData(const Graph& graph) {
             const size_t vertex_count = graph.GetVertexCount();
             for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
-                for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                    const auto& edge = graph.GetEdge(edge_id);
-                    if (edge.weight < ZERO_WEIGHT) {
+                weights_[vertex * vertex_count + vertex] = ZERO_WEIGHT;
+                const OutgoingArcs<Weight> arcs = graph.GetOutgoingArcs(vertex);
+                for (size_t i = 0; i < arcs.size; ++i) {
+                    if (arcs.weights[i] < Weight{}) {
                         throw std::domain_error("Edges' weights should be non-negative");
                     }
-                    auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{ edge.weight, edge_id };
+                    const size_t cell = vertex * vertex_count + arcs.targets[i];
+                    if (static_cast<TableWeight>(arcs.weights[i]) < weights_[cell]) {
+                        weights_[cell] = static_cast<TableWeight>(arcs.weights[i]);
+                        prev_edges_[cell] = static_cast<uint32_t>(arcs.edges[i]);
                     }
                 }
             }
         }
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-            const RouteInternalData& route_to) {
-            auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-                route_relaxing = { candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
-            }
-        }
-
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+        // relaxes the rows [row_begin, row_end) tile by tile, so that a tile of the pivot row
+        // stays in cache while it is used for all the rows
+        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through,
+            VertexId row_begin, VertexId row_end) {
+            const TableWeight* weights_through = &weights_[vertex_through * vertex_count];
+            const uint32_t* prev_edges_through = &prev_edges_[vertex_through * vertex_count];
+            for (VertexId column_begin = 0; column_begin < vertex_count; column_begin += COLUMN_TILE_SIZE) {
+                const VertexId column_end = std::min(column_begin + COLUMN_TILE_SIZE, vertex_count);
+                for (VertexId vertex_from = row_begin; vertex_from < row_end; ++vertex_from) {
+                    TableWeight* weights_from = &weights_[vertex_from * vertex_count];
+                    uint32_t* prev_edges_from = &prev_edges_[vertex_from * vertex_count];
+                    const TableWeight weight_from = weights_from[vertex_through];
+                    if (weight_from == INFINITE_WEIGHT) {
+                        continue;
+                    }
+                    const uint32_t prev_edge_from = prev_edges_from[vertex_through];
+                    for (VertexId vertex_to = column_begin; vertex_to < column_end; ++vertex_to) {
+                        // a missing route through the vertex gives an infinite candidate, which is never less
+                        const TableWeight candidate_weight = weight_from + weights_through[vertex_to];
+                        if (candidate_weight < weights_from[vertex_to]) {
+                            weights_from[vertex_to] = candidate_weight;
+                            prev_edges_from[vertex_to] = prev_edges_through[vertex_to] != NO_EDGE
+                                ? prev_edges_through[vertex_to] : prev_edge_from;
                         }
                     }
                 }
             }
         }
 
-        static constexpr Weight ZERO_WEIGHT{};
+        void RelaxRoutesInternalData(size_t vertex_count, size_t thread_count);
+
+        class Barrier {
+        public:
+            explicit Barrier(size_t count)
+                : count_(count) {
+            }
+
+            void Wait() {
+                std::unique_lock lock(mutex_);
+                const size_t generation = generation_;
+                if (++waiting_ == count_) {
+                    waiting_ = 0;
+                    ++generation_;
+                    released_.notify_all();
+                }
+                else {
+                    released_.wait(lock, [this, generation] { return generation != generation_; });
+                }
+            }
+
+        private:
+            std::mutex mutex_;
+            std::condition_variable released_;
+            size_t count_;
+            size_t waiting_ = 0;
+            size_t generation_ = 0;
+        };
+
+        static_assert(std::numeric_limits<TableWeight>::has_infinity, "Missing routes are marked by infinite weight");
+
+        static constexpr size_t ROW_TILE_SIZE = 16;
+        static constexpr size_t COLUMN_TILE_SIZE = 8192; // about 256 KB of the pivot row, only large tables are split
+        static constexpr TableWeight ZERO_WEIGHT{};
+        static constexpr TableWeight INFINITE_WEIGHT = std::numeric_limits<TableWeight>::infinity();
+        static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+
         const Graph& graph_;
-        RoutesInternalData routes_internal_data_;
+        size_t vertex_count_;
+        std::vector<TableWeight> weights_; // empty if the table is not owned
+        std::vector<uint32_t> prev_edges_;
+        const TableWeight* table_weights_ = nullptr;
+        const uint32_t* table_prev_edges_ = nullptr;
     };
 
-    template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    template <typename Weight, typename TableWeight>
+    Router<Weight, TableWeight>::Router(const Graph& graph, size_t thread_count)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+        , vertex_count_(graph.GetVertexCount())
+        , weights_(graph.GetVertexCount() * graph.GetVertexCount(), INFINITE_WEIGHT)
+        , prev_edges_(graph.GetVertexCount() * graph.GetVertexCount(), NO_EDGE)
     {
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for 32-bit edge ids");
+        }
         InitializeRoutesInternalData(graph);
+        RelaxRoutesInternalData(vertex_count_, thread_count);
+        table_weights_ = weights_.data();
+        table_prev_edges_ = prev_edges_.data();
+    }
 
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    template <typename Weight, typename TableWeight>
+    Router<Weight, TableWeight>::Router(const Graph& graph, const TableWeight* weights, const uint32_t* prev_edges)
+        : graph_(graph)
+        , vertex_count_(graph.GetVertexCount())
+        , table_weights_(weights)
+        , table_prev_edges_(prev_edges)
+    {
+    }
+
+    template <typename Weight, typename TableWeight>
+    void Router<Weight, TableWeight>::RelaxRoutesInternalData(size_t vertex_count, size_t thread_count) {
+        const size_t tile_count = (vertex_count + ROW_TILE_SIZE - 1) / ROW_TILE_SIZE;
+        thread_count = std::max<size_t>(1, std::min(thread_count, tile_count));
+
+        if (thread_count == 1) {
+            for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
+                RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through, 0, vertex_count);
+            }
+            return;
+        }
+
+        // every thread takes every thread_count-th tile of rows, phases are separated by the barrier
+        Barrier barrier(thread_count);
+        const auto relax_tiles = [&](size_t thread_index) {
+            for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
+                for (size_t tile = thread_index; tile < tile_count; tile += thread_count) {
+                    const VertexId row_begin = tile * ROW_TILE_SIZE;
+                    RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through,
+                        row_begin, std::min(row_begin + ROW_TILE_SIZE, vertex_count));
+                }
+                barrier.Wait();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t thread_index = 1; thread_index < thread_count; ++thread_index) {
+            threads.emplace_back(relax_tiles, thread_index);
+        }
+        relax_tiles(0);
+        for (std::thread& thread : threads) {
+            thread.join();
         }
     }
 
-    template <typename Weight>
-    std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
-        VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+    template <typename Weight, typename TableWeight>
+    std::optional<typename Router<Weight, TableWeight>::RouteInfo> Router<Weight, TableWeight>::BuildRoute(
+        VertexId from, VertexId to) const {
+        if (from >= vertex_count_ || to >= vertex_count_) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const TableWeight* weights_from = table_weights_ + from * vertex_count_;
+        const uint32_t* prev_edges_from = table_prev_edges_ + from * vertex_count_;
+        if (weights_from[to] == INFINITE_WEIGHT) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
         std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+        for (uint32_t edge_id = prev_edges_from[to]; edge_id != NO_EDGE;
+            edge_id = prev_edges_from[graph_.GetEdge(edge_id).from])
         {
-            edges.push_back(*edge_id);
+            edges.push_back(edge_id);
         }
         std::reverse(edges.begin(), edges.end());
 
-        return RouteInfo{ weight, std::move(edges) };
+        return RouteInfo{ static_cast<Weight>(weights_from[to]), std::move(edges) };
     }
 
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,174 @@
+﻿#define _USE_MATH_DEFINES
+#include "stop_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace transport_catalogue {
+
+    namespace {
+        const double EARTH_RADIUS = 6371000;
+        const double DEGREE = M_PI / 180.0;
+
+        // degrees from a to b eastward, in [0, 360)
+        double GetEastwardGap(double a, double b) {
+            const double gap = std::fmod(b - a, 360.0);
+            return gap < 0.0 ? gap + 360.0 : gap;
+        }
+
+        bool IsInLngRange(double lng, double min_lng, double max_lng) {
+            return min_lng <= max_lng ? min_lng <= lng && lng <= max_lng : lng >= min_lng || lng <= max_lng;
+        }
+    }
+
+    StopIndex::StopIndex(const std::vector<geo::Coordinates>& coordinates)
+        : boxes_(coordinates.size())
+    {
+        entries_.reserve(coordinates.size());
+        for (size_t i = 0; i < coordinates.size(); ++i) {
+            entries_.push_back({ coordinates[i], static_cast<StopId>(i) });
+        }
+        Build(0, entries_.size());
+    }
+
+    void StopIndex::Build(size_t begin, size_t end) {
+        if (begin == end) {
+            return;
+        }
+        const geo::Coordinates& first = entries_[begin].point;
+        Box box{ first.lat, first.lat, first.lng, first.lng };
+        for (size_t i = begin + 1; i < end; ++i) {
+            const geo::Coordinates& point = entries_[i].point;
+            box.min_lat = std::min(box.min_lat, point.lat);
+            box.max_lat = std::max(box.max_lat, point.lat);
+            box.min_lng = std::min(box.min_lng, point.lng);
+            box.max_lng = std::max(box.max_lng, point.lng);
+        }
+
+        // splits the longer side, a degree of longitude is shorter away from the equator
+        const double lng_scale = std::cos((box.min_lat + box.max_lat) / 2 * DEGREE);
+        const bool by_lat = box.max_lat - box.min_lat >= (box.max_lng - box.min_lng) * lng_scale;
+        const size_t middle = (begin + end) / 2;
+        std::nth_element(entries_.begin() + begin, entries_.begin() + middle, entries_.begin() + end,
+            [by_lat](const Entry& lhs, const Entry& rhs) {
+                return by_lat ? lhs.point.lat < rhs.point.lat : lhs.point.lng < rhs.point.lng;
+            });
+
+        boxes_[middle] = box;
+        Build(begin, middle);
+        Build(middle + 1, end);
+    }
+
+    double StopIndex::ComputeLowerBound(geo::Coordinates point, const Box& box) {
+        double lat_gap = 0.0;
+        if (point.lat < box.min_lat) {
+            lat_gap = box.min_lat - point.lat;
+        }
+        else if (point.lat > box.max_lat) {
+            lat_gap = point.lat - box.max_lat;
+        }
+        double lng_gap = 0.0;
+        if (!IsInLngRange(point.lng, box.min_lng, box.max_lng)) {
+            lng_gap = std::min(GetEastwardGap(point.lng, box.min_lng), GetEastwardGap(box.max_lng, point.lng));
+        }
+        // a point that far in longitude is not nearer than the meridian plane at that angle
+        const double lng_bound = std::asin(std::min(1.0,
+            std::cos(point.lat * DEGREE) * std::sin(std::min(lng_gap, 90.0) * DEGREE)));
+        // a little below the exact value, so that rounding never skips a stop
+        return std::max(lat_gap * DEGREE, lng_bound) * EARTH_RADIUS * (1.0 - 1e-9);
+    }
+
+    std::vector<std::pair<StopId, double>> StopIndex::FindNearest(geo::Coordinates point, size_t count) const {
+        std::vector<std::pair<double, StopId>> heap; // the farthest found stop on top
+        if (count > 0) {
+            heap.reserve(std::min(count, entries_.size()) + 1);
+            FindNearest(0, entries_.size(), point, count, heap);
+        }
+        std::sort_heap(heap.begin(), heap.end());
+        std::vector<std::pair<StopId, double>> nearest;
+        nearest.reserve(heap.size());
+        for (const auto& [distance, stop] : heap) {
+            nearest.emplace_back(stop, distance);
+        }
+        return nearest;
+    }
+
+    void StopIndex::FindNearest(size_t begin, size_t end, geo::Coordinates point, size_t count,
+        std::vector<std::pair<double, StopId>>& heap) const {
+        if (begin == end) {
+            return;
+        }
+        const size_t middle = (begin + end) / 2;
+        if (heap.size() == count && ComputeLowerBound(point, boxes_[middle]) > heap.front().first) {
+            return;
+        }
+
+        const std::pair<double, StopId> candidate{ geo::ComputeHaversineDistance(point, entries_[middle].point),
+            entries_[middle].stop };
+        if (heap.size() < count) {
+            heap.push_back(candidate);
+            std::push_heap(heap.begin(), heap.end());
+        }
+        else if (candidate < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = candidate;
+            std::push_heap(heap.begin(), heap.end());
+        }
+
+        // the half nearer to the point first, so that the other one is more likely to be skipped
+        const size_t lower_middle = (begin + middle) / 2;
+        const size_t upper_middle = (middle + 1 + end) / 2;
+        const bool lower_first = begin == middle || (middle + 1 != end
+            && ComputeLowerBound(point, boxes_[lower_middle]) <= ComputeLowerBound(point, boxes_[upper_middle]));
+        if (lower_first) {
+            FindNearest(begin, middle, point, count, heap);
+            FindNearest(middle + 1, end, point, count, heap);
+        }
+        else {
+            FindNearest(middle + 1, end, point, count, heap);
+            FindNearest(begin, middle, point, count, heap);
+        }
+    }
+
+    std::vector<StopId> StopIndex::FindInBox(geo::Coordinates min, geo::Coordinates max) const {
+        std::vector<StopId> stops;
+        FindInBox(0, entries_.size(), { min.lat, max.lat, min.lng, max.lng }, stops);
+        std::sort(stops.begin(), stops.end());
+        return stops;
+    }
+
+    void StopIndex::FindInBox(size_t begin, size_t end, const Box& box, std::vector<StopId>& stops) const {
+        if (begin == end) {
+            return;
+        }
+        const size_t middle = (begin + end) / 2;
+        const Box& subtree = boxes_[middle];
+        if (subtree.max_lat < box.min_lat || subtree.min_lat > box.max_lat) {
+            return;
+        }
+        const bool wraps = box.min_lng > box.max_lng;
+        const bool meets_lng = wraps
+            ? subtree.max_lng >= box.min_lng || subtree.min_lng <= box.max_lng
+            : subtree.max_lng >= box.min_lng && subtree.min_lng <= box.max_lng;
+        if (!meets_lng) {
+            return;
+        }
+        const bool inside_lng = wraps
+            ? subtree.min_lng >= box.min_lng || subtree.max_lng <= box.max_lng
+            : subtree.min_lng >= box.min_lng && subtree.max_lng <= box.max_lng;
+        if (inside_lng && subtree.min_lat >= box.min_lat && subtree.max_lat <= box.max_lat) {
+            for (size_t i = begin; i < end; ++i) {
+                stops.push_back(entries_[i].stop);
+            }
+            return;
+        }
+
+        const geo::Coordinates& point = entries_[middle].point;
+        if (box.min_lat <= point.lat && point.lat <= box.max_lat && IsInLngRange(point.lng, box.min_lng, box.max_lng)) {
+            stops.push_back(entries_[middle].stop);
+        }
+        FindInBox(begin, middle, box, stops);
+        FindInBox(middle + 1, end, box, stops);
+    }
+
+}  // namespace transport_catalogue
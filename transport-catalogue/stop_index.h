@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "domain.h"
+#include "geo.h"
+
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+    // k-d tree over the stop coordinates. Every subtree keeps the box of its stops, which gives a lower bound
+    // of the great-circle distance to all of them, so the searches skip the subtrees that cannot matter.
+    // Longitudes are taken around the circle, a box may cross the 180th meridian
+    class StopIndex {
+    public:
+        StopIndex() = default;
+        // coordinates by stop id
+        explicit StopIndex(const std::vector<geo::Coordinates>& coordinates);
+
+        // at most count stops nearest to the point with their distances in meters, nearest first,
+        // equally distant ones by stop id
+        std::vector<std::pair<StopId, double>> FindNearest(geo::Coordinates point, size_t count) const;
+
+        // stops with the latitude in [min.lat, max.lat] and the longitude in [min.lng, max.lng], by stop id.
+        // min.lng > max.lng is a box that crosses the 180th meridian
+        std::vector<StopId> FindInBox(geo::Coordinates min, geo::Coordinates max) const;
+
+    private:
+        struct Box {
+            double min_lat;
+            double max_lat;
+            double min_lng;
+            double max_lng;
+        };
+
+        // the subtree of [begin, end) has its root in the middle, both halves are subtrees too
+        void Build(size_t begin, size_t end);
+
+        void FindNearest(size_t begin, size_t end, geo::Coordinates point, size_t count,
+            std::vector<std::pair<double, StopId>>& heap) const;
+
+        void FindInBox(size_t begin, size_t end, const Box& box, std::vector<StopId>& stops) const;
+
+        // the great-circle distance from the point to any point of the box is not less
+        static double ComputeLowerBound(geo::Coordinates point, const Box& box);
+
+        struct Entry {
+            geo::Coordinates point;
+            StopId stop;
+        };
+
+        std::vector<Entry> entries_;
+        std::vector<Box> boxes_; // of the subtree rooted at the same position
+    };
+
+}  // namespace transport_catalogue
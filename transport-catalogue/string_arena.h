@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace transport_catalogue {
+
+    // keeps copies of strings in large blocks that are freed all together. The copies never move,
+    // so their views stay valid while the arena lives, moving the arena included
+    class StringArena {
+    public:
+        explicit StringArena(size_t block_size = 64 * 1024)
+            : block_size_(block_size) {
+        }
+
+        std::string_view Store(std::string_view text) {
+            if (text.size() > free_size_) {
+                // a string longer than a block gets a block of its own
+                const size_t size = std::max(block_size_, text.size());
+                blocks_.push_back(std::make_unique<char[]>(size));
+                free_ = blocks_.back().get();
+                free_size_ = size;
+            }
+            if (!text.empty()) {
+                std::memcpy(free_, text.data(), text.size());
+            }
+            const std::string_view stored(free_, text.size());
+            free_ += text.size();
+            free_size_ -= text.size();
+            return stored;
+        }
+
+    private:
+        size_t block_size_;
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        char* free_ = nullptr;
+        size_t free_size_ = 0;
+    };
+
+}  // namespace transport_catalogue
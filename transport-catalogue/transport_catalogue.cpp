@@ -2,148 +2,302 @@
 
 namespace transport_catalogue {
 
-	void TransportCatalogue::AddStop(const std::string_view stop_name, geo::Coordinates coordinates) {
-		all_stops_.emplace_back(std::string(stop_name), coordinates);
-		Stop* current_stop = &all_stops_.back();
-		stops_catalogue_[current_stop->name] = current_stop;
-		stops_to_buses_[current_stop->name];
+	void TransportCatalogue::Freeze() {
+		if (is_frozen_) {
+			return;
+		}
+		// marks the stops already counted for a bus by its id, so that one array serves all the buses
+		std::vector<BusId> stop_marks(stop_names_.size(), static_cast<BusId>(-1));
+		bus_infos_.reserve(bus_names_.size());
+		for (BusId id = 0; id < bus_names_.size(); ++id) {
+			bus_infos_.push_back(ComputeBusInfo(id, stop_marks));
+		}
+
+		// the buses of every stop, in the name order and without repeats
+		std::vector<BusId> sorted_buses(bus_names_.size());
+		for (BusId id = 0; id < bus_names_.size(); ++id) {
+			sorted_buses[id] = id;
+		}
+		std::sort(sorted_buses.begin(), sorted_buses.end(),
+			[this](BusId lhs, BusId rhs) {
+				return bus_names_[lhs] < bus_names_[rhs];
+			});
+		std::fill(stop_marks.begin(), stop_marks.end(), static_cast<BusId>(-1));
+		stop_bus_offsets_.assign(stop_names_.size() + 1, 0);
+		for (BusId id : sorted_buses) {
+			for (StopId stop : GetBus(id).route) {
+				if (stop_marks[stop] != id) {
+					stop_marks[stop] = id;
+					++stop_bus_offsets_[stop + 1];
+				}
+			}
+		}
+		for (StopId stop = 0; stop < stop_names_.size(); ++stop) {
+			stop_bus_offsets_[stop + 1] += stop_bus_offsets_[stop];
+		}
+		stop_buses_.resize(stop_bus_offsets_.back());
+		std::vector<size_t> positions(stop_bus_offsets_.begin(), stop_bus_offsets_.end() - 1);
+		std::fill(stop_marks.begin(), stop_marks.end(), static_cast<BusId>(-1));
+		for (BusId id : sorted_buses) {
+			for (StopId stop : GetBus(id).route) {
+				if (stop_marks[stop] != id) {
+					stop_marks[stop] = id;
+					stop_buses_[positions[stop]++] = id;
+				}
+			}
+		}
+		stop_index_ = StopIndex(stop_coordinates_);
+		stop_ids_.Freeze();
+		bus_ids_.Freeze();
+		is_frozen_ = true;
+	}
+
+	bool TransportCatalogue::IsFrozen() const {
+		return is_frozen_;
+	}
+
+	void TransportCatalogue::CheckNotFrozen() const {
+		if (is_frozen_) {
+			throw std::logic_error("Catalogue is frozen");
+		}
+	}
+
+	StopId TransportCatalogue::AddStop(const std::string_view stop_name, geo::Coordinates coordinates) {
+		CheckNotFrozen();
+		const StopId id = static_cast<StopId>(stop_names_.size());
+		stop_names_.push_back(names_.Store(stop_name));
+		stop_coordinates_.push_back(coordinates);
+		stop_ids_.Add(stop_names_.back(), id);
+		return id;
 	}
 
-	Stop* TransportCatalogue::FindStop(std::string_view stop_name) const {
-		if (stops_catalogue_.find(stop_name) != stops_catalogue_.end()) {
-			return stops_catalogue_.at(stop_name);
+	std::optional<Stop> TransportCatalogue::FindStop(std::string_view stop_name) const {
+		if (const std::optional<StopId> id = stop_ids_.Find(stop_name)) {
+			return GetStop(*id);
 		}
-		return nullptr;
+		return std::nullopt;
+	}
+
+	StopId TransportCatalogue::GetStopId(std::string_view stop_name) const {
+		if (const std::optional<StopId> id = stop_ids_.Find(stop_name)) {
+			return *id;
+		}
+		throw std::out_of_range("Unknown stop");
+	}
+
+	Stop TransportCatalogue::GetStop(StopId id) const {
+		return { id, stop_names_.at(id), stop_coordinates_[id] };
+	}
+
+	size_t TransportCatalogue::GetStopCount() const {
+		return stop_names_.size();
 	}
 
 	int TransportCatalogue::GetDistance(const std::string_view stop_from, const std::string_view stop_to) const {
-		Stop* from = FindStop(stop_from);
-		Stop* to = FindStop(stop_to);
-		if (auto it = distances_.find({ from, to }); it != distances_.end()) {
-			return it->second;
+		return GetDistance(GetStopId(stop_from), GetStopId(stop_to));
+	}
+
+	int TransportCatalogue::GetDistance(StopId stop_from, StopId stop_to) const {
+		if (const std::optional<int> distance = distances_.Find(stop_from, stop_to); distance != std::nullopt) {
+			return *distance;
 		}
 		else {
 			if (stop_from == stop_to) return 0;
-			return distances_.at({ to, from });
+			throw std::out_of_range("Unknown distance");
 		}
 	}
 
-	std::optional<std::set<std::string_view>> TransportCatalogue::GetStopInfo(std::string_view requested_stop) const {
-		if (FindStop(requested_stop) != nullptr) {
-			std::set<std::string_view> buses;
-			if (stops_to_buses_.find(requested_stop) != stops_to_buses_.end()) {
-				for (std::string_view bus : stops_to_buses_.at(requested_stop)) {
-					buses.insert(bus);
-				}
-			}
-			return buses;
+	std::optional<ranges::Range<const BusId*>> TransportCatalogue::GetStopInfo(std::string_view requested_stop) const {
+		if (!is_frozen_) {
+			throw std::logic_error("Catalogue is not frozen");
+		}
+		if (const std::optional<StopId> id = stop_ids_.Find(requested_stop)) {
+			const BusId* buses = stop_buses_.data();
+			return ranges::Range{ buses + stop_bus_offsets_[*id], buses + stop_bus_offsets_[*id + 1] };
 		}
 		else {
 			return std::nullopt;
 		}
 	}
 
-	void TransportCatalogue::AddBus(const std::string_view id, const std::vector<std::string_view>&& stops, bool is_roundtrip) {
-		std::vector<Stop*> route_stops;
+	BusId TransportCatalogue::AddBus(const std::string_view id, const std::vector<std::string_view>&& stops, bool is_roundtrip) {
+		CheckNotFrozen();
+		const BusId bus_id = static_cast<BusId>(bus_names_.size());
+		bus_names_.push_back(names_.Store(id));
 		for (const std::string_view& stop : stops) {
-			if (stops_catalogue_.find(stop) != stops_catalogue_.end()) {
-				route_stops.push_back(stops_catalogue_[stop]);
+			if (const std::optional<StopId> stop_id = stop_ids_.Find(stop)) {
+				route_stops_.push_back(*stop_id);
 			}
 		}
-		all_buses_.emplace_back(std::string(id), std::move(route_stops), is_roundtrip);
-		buses_catalogue_[all_buses_.back().route_name] = &all_buses_.back();
-		for (const std::string_view& stop : stops) {
-			stops_to_buses_[stop].insert(all_buses_.back().route_name);
+		route_offsets_.push_back(route_stops_.size());
+		bus_roundtrips_.push_back(is_roundtrip);
+		bus_ids_.Add(bus_names_.back(), bus_id);
+		return bus_id;
+	}
+
+	BusId TransportCatalogue::AddBus(const std::string_view id, const std::vector<StopId>& stops, bool is_roundtrip) {
+		CheckNotFrozen();
+		for (StopId stop : stops) {
+			if (stop >= stop_names_.size()) {
+				throw std::out_of_range("Stop id is out of range");
+			}
 		}
+		const BusId bus_id = static_cast<BusId>(bus_names_.size());
+		bus_names_.push_back(names_.Store(id));
+		route_stops_.insert(route_stops_.end(), stops.begin(), stops.end());
+		route_offsets_.push_back(route_stops_.size());
+		bus_roundtrips_.push_back(is_roundtrip);
+		bus_ids_.Add(bus_names_.back(), bus_id);
+		return bus_id;
 	}
 
-	const Bus* TransportCatalogue::FindBus(std::string_view route_name) const {
-		if (buses_catalogue_.find(route_name) == buses_catalogue_.end()) {
-			return nullptr;
+	std::optional<Bus> TransportCatalogue::FindBus(std::string_view route_name) const {
+		if (const std::optional<BusId> id = bus_ids_.Find(route_name)) {
+			return GetBus(*id);
 		}
-		return buses_catalogue_.at(route_name);
+		return std::nullopt;
 	}
 
-	std::optional<BusInfo> TransportCatalogue::GetBusInfo(std::string_view requested_bus) const {
-		if (const Bus* bus = FindBus(requested_bus); bus != nullptr) {
+	Bus TransportCatalogue::GetBus(BusId id) const {
+		const StopId* stops = route_stops_.data();
+		return { id, bus_names_.at(id), { stops + route_offsets_[id], stops + route_offsets_[id + 1] }, bus_roundtrips_[id] };
+	}
 
-			double geo_route_length = 0.0;
-			int road_route_distance = 0;
-			for (int i = 1, size = bus->route.size(); i < size; ++i) {
-				geo_route_length += geo::ComputeDistance(bus->route[i - 1]->coordinates, bus->route[i]->coordinates);
+	size_t TransportCatalogue::GetBusCount() const {
+		return bus_names_.size();
+	}
 
-				if (distances_.find({ bus->route[i - 1], bus->route[i] }) != distances_.end()) {
-					road_route_distance += distances_.at({ bus->route[i - 1], bus->route[i] });
-				}
-				else {
-					road_route_distance += distances_.at({ bus->route[i], bus->route[i - 1] });
-				}
+	std::optional<BusInfo> TransportCatalogue::GetBusInfo(std::string_view requested_bus) const {
+		if (const std::optional<BusId> id = bus_ids_.Find(requested_bus)) {
+			if (is_frozen_) {
+				return bus_infos_[*id];
 			}
-
-			double curvature = static_cast<double>(road_route_distance) / geo_route_length;
-
-			BusInfo bus_info(bus->route.size(), CountUniqueStops(requested_bus), road_route_distance, curvature, bus->is_roundtrip);
-			return bus_info;
+			std::vector<BusId> stop_marks(stop_names_.size(), static_cast<BusId>(-1));
+			return ComputeBusInfo(*id, stop_marks);
 		}
 		else {
 			return std::nullopt;
 		}
 	}
 
-	int TransportCatalogue::CountUniqueStops(std::string_view bus) const {
-		std::unordered_set<Stop*> unique_stops;
-		for (Stop* stop : buses_catalogue_.at(bus)->route) {
-			unique_stops.insert(stop);
+	BusInfo TransportCatalogue::ComputeBusInfo(BusId id, std::vector<BusId>& stop_marks) const {
+		const Bus bus = GetBus(id);
+
+		double geo_route_length = 0.0;
+		int road_route_distance = 0;
+		for (int i = 1, size = bus.route.size(); i < size; ++i) {
+			geo_route_length += geo::ComputeDistance(stop_coordinates_[bus.route[i - 1]], stop_coordinates_[bus.route[i]]);
+
+			road_route_distance += GetDistance(bus.route[i - 1], bus.route[i]);
+		}
+
+		double curvature = static_cast<double>(road_route_distance) / geo_route_length;
+
+		int unique_stops_count = 0;
+		for (StopId stop : bus.route) {
+			if (stop_marks[stop] != id) {
+				stop_marks[stop] = id;
+				++unique_stops_count;
+			}
 		}
-		return unique_stops.size();
+
+		BusInfo bus_info(bus.route.size(), unique_stops_count, road_route_distance, curvature, bus.is_roundtrip);
+		return bus_info;
 	}
 
 	void TransportCatalogue::AddDistances(const std::string_view stop_from, const std::pair<const std::string, json::Node> distances) {
-			distances_[std::pair{ stops_catalogue_.at(stop_from), stops_catalogue_.at(distances.first) }] = distances.second.AsInt();
+			CheckNotFrozen();
+			distances_.Add(GetStopId(stop_from), GetStopId(distances.first), distances.second.AsInt());
+	}
+
+	void TransportCatalogue::ReserveDistances(size_t count) {
+		distances_.Reserve(count);
+	}
+
+	void TransportCatalogue::AddDistance(StopId stop_from, StopId stop_to, int distance) {
+		CheckNotFrozen();
+		if (stop_from >= stop_names_.size() || stop_to >= stop_names_.size()) {
+			throw std::out_of_range("Stop id is out of range");
+		}
+		distances_.Add(stop_from, stop_to, distance);
 	}
 
-	std::vector<const Bus*> TransportCatalogue::GetBusCatalogue() const {
-		std::vector<const Bus*> buses;
-		for (const auto& pair : buses_catalogue_) {
-			buses.push_back(pair.second);
+	std::vector<Bus> TransportCatalogue::GetBusCatalogue() const {
+		std::vector<Bus> buses;
+		buses.reserve(bus_names_.size());
+		for (BusId id = 0; id < bus_names_.size(); ++id) {
+			buses.push_back(GetBus(id));
 		}
 		std::sort(buses.begin(), buses.end(),
-			[](const Bus* lhs, const Bus* rhs) {
-				return lhs->route_name < rhs->route_name;
+			[](const Bus& lhs, const Bus& rhs) {
+				return lhs.route_name < rhs.route_name;
 			});
 		return buses;
 	}
 
-	bool CompareStops(const Stop* s1, const Stop* s2) {
-		return s1->name == s2->name;
+	std::vector<Stop> TransportCatalogue::GetStopCatalogue() const {
+		std::vector<bool> is_on_route(stop_names_.size(), false);
+		for (StopId stop : route_stops_) {
+			is_on_route[stop] = true;
+		}
+		std::vector<Stop> stops;
+		for (StopId id = 0; id < stop_names_.size(); ++id) {
+			if (is_on_route[id]) {
+				stops.push_back(GetStop(id));
+			}
+		}
+		std::sort(stops.begin(), stops.end(),
+			[](const Stop& lhs, const Stop& rhs) {
+				return lhs.name < rhs.name;
+			});
+		return stops;
 	}
 
-	std::vector<const Stop*> TransportCatalogue::GetStopCatalogue() const {
-		std::vector<const Stop*> stops;
-		for (const Bus& bus : all_buses_) {
-			if (!bus.route.empty()) {
-				for (const Stop* stop : bus.route) {
-					stops.push_back(stop);
-				}
-			}
+	std::vector<Stop> TransportCatalogue::GetSortedStops() const {
+		std::vector<Stop> stops;
+		stops.reserve(stop_names_.size());
+		for (StopId id = 0; id < stop_names_.size(); ++id) {
+			stops.push_back(GetStop(id));
 		}
 		std::sort(stops.begin(), stops.end(),
-			[](const Stop* lhs, const Stop* rhs) {
-				return lhs->name < rhs->name;
+			[](const Stop& lhs, const Stop& rhs) {
+				return lhs.name < rhs.name;
 			});
-		stops.erase(std::unique(stops.begin(), stops.end(), CompareStops), stops.end());
 		return stops;
 	}
 
-	size_t TransportCatalogue::Hasher::operator()(const std::pair<Stop*, Stop*>& pair) const {
-		return (size_t)std::hash<const void*>{}(pair.first) * 17 + (size_t)std::hash<const void*>{}(pair.second) * 23;
+	std::vector<std::pair<Stop, double>> TransportCatalogue::FindNearestStops(geo::Coordinates point, size_t count) const {
+		if (!is_frozen_) {
+			throw std::logic_error("Catalogue is not frozen");
+		}
+		std::vector<std::pair<Stop, double>> stops;
+		for (const auto& [id, distance] : stop_index_.FindNearest(point, count)) {
+			stops.emplace_back(GetStop(id), distance);
+		}
+		return stops;
+	}
+
+	std::vector<Stop> TransportCatalogue::FindStopsInBox(geo::Coordinates min, geo::Coordinates max) const {
+		if (!is_frozen_) {
+			throw std::logic_error("Catalogue is not frozen");
+		}
+		std::vector<Stop> stops;
+		for (StopId id : stop_index_.FindInBox(min, max)) {
+			stops.push_back(GetStop(id));
+		}
+		std::sort(stops.begin(), stops.end(),
+			[](const Stop& lhs, const Stop& rhs) {
+				return lhs.name < rhs.name;
+			});
+		return stops;
 	}
 
-	std::map<std::string_view, Stop*> TransportCatalogue::GetSortedStops() const {
-		return { stops_catalogue_.begin(), stops_catalogue_.end() };
+	void SnapshotHolder::Publish(TransportCatalogue&& catalogue) {
+		catalogue.Freeze();
+		snapshot_.store(std::make_shared<const TransportCatalogue>(std::move(catalogue)));
 	}
 
-	std::map<std::string_view, Bus*> TransportCatalogue::GetSortedBuses() const {
-		return { buses_catalogue_.begin(), buses_catalogue_.end() };
+	SnapshotHolder::Snapshot SnapshotHolder::Get() const {
+		return snapshot_.load();
 	}
 }
\ No newline at end of file
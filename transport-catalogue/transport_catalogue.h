@@ -1,66 +1,147 @@
 ﻿#pragma once
 
 #include <algorithm>
-#include <deque>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <optional>
-#include <set>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <tuple>
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 #include "geo.h"
 #include "json.h"
+#include "distance_table.h"
 #include "domain.h"
+#include "name_index.h"
+#include "stop_index.h"
+#include "string_arena.h"
 
 namespace transport_catalogue {
 
+	// stops and buses get dense ids in the order they are added. Their data is kept in columns indexed
+	// by the ids, the stops of all the routes lie one after another in a single array of stop ids.
+	// Freeze ends the loading: the statistics of the buses are computed once and nothing can be added any more
 	class TransportCatalogue {
 
 	public:
+		TransportCatalogue() = default;
+		// the views of the names would point into the copied catalogue, moving keeps them valid
+		TransportCatalogue(const TransportCatalogue&) = delete;
+		TransportCatalogue& operator=(const TransportCatalogue&) = delete;
+		TransportCatalogue(TransportCatalogue&&) = default;
+		TransportCatalogue& operator=(TransportCatalogue&&) = default;
 
-		void AddStop(const std::string_view stop_name, geo::Coordinates coordinates);
+		// the const methods of a frozen catalogue change nothing, so any threads may call them at once
+		void Freeze();
 
-		Stop* FindStop(std::string_view stop_name) const;
+		bool IsFrozen() const;
 
-		std::optional<std::set<std::string_view>> GetStopInfo(std::string_view requested_stop) const;
+		StopId AddStop(const std::string_view stop_name, geo::Coordinates coordinates);
 
-		void AddBus(const std::string_view id, const std::vector<std::string_view>&& stops, bool is_roundtrip);
+		std::optional<Stop> FindStop(std::string_view stop_name) const;
 
-		const Bus* FindBus(std::string_view route_name) const;
+		Stop GetStop(StopId id) const;
 
+		size_t GetStopCount() const;
+
+		// buses through the stop by name, a view of the catalogue made by Freeze. Throws before Freeze
+		std::optional<ranges::Range<const BusId*>> GetStopInfo(std::string_view requested_stop) const;
+
+		// stops that are not in the catalogue are left out of the route
+		BusId AddBus(const std::string_view id, const std::vector<std::string_view>&& stops, bool is_roundtrip);
+		// the stops have to be in the catalogue
+		BusId AddBus(const std::string_view id, const std::vector<StopId>& stops, bool is_roundtrip);
+
+		std::optional<Bus> FindBus(std::string_view route_name) const;
+
+		Bus GetBus(BusId id) const;
+
+		size_t GetBusCount() const;
+
+		// taken from the ones computed by Freeze, computed on every call before it
 		std::optional<BusInfo> GetBusInfo(std::string_view requested_bus) const;
 
 		void AddDistances(const std::string_view stop_from, const std::pair<const std::string, json::Node> distances);
+		void AddDistance(StopId stop_from, StopId stop_to, int distance);
+		// makes room for the distances between the given number of pairs of stops
+		void ReserveDistances(size_t count);
+
+		// calls callback(from, to, distance) for the distances that were added
+		template <typename Callback>
+		void ForEachDistance(Callback callback) const {
+			distances_.ForEach(callback);
+		}
 
 		int GetDistance(const std::string_view stop_from, const std::string_view stop_to) const;
+		int GetDistance(StopId stop_from, StopId stop_to) const;
+
+		// all the buses by name
+		std::vector<Bus> GetBusCatalogue() const;
 
-		std::vector<const Bus*> GetBusCatalogue() const;
+		// stops of the routes by name
+		std::vector<Stop> GetStopCatalogue() const;
 
-		std::vector<const Stop*> GetStopCatalogue() const;
+		// all the stops by name
+		std::vector<Stop> GetSortedStops() const;
 
-		std::map<std::string_view, Stop*> GetSortedStops() const;
+		// at most count stops nearest to the point with the distances in meters, nearest first. Throws before Freeze
+		std::vector<std::pair<Stop, double>> FindNearestStops(geo::Coordinates point, size_t count) const;
 
-		std::map<std::string_view, Bus*> GetSortedBuses() const;
+		// stops within the bounds of latitude and longitude, by name. min.lng > max.lng is a box that crosses
+		// the 180th meridian. Throws before Freeze
+		std::vector<Stop> FindStopsInBox(geo::Coordinates min, geo::Coordinates max) const;
 
 	private:
-		class Hasher {
-		public:
-			size_t operator()(const std::pair<Stop*, Stop*>& pair) const;
-		};
+		StringArena names_; // of the stops and the buses, the columns keep views of them
+
+		// stop columns
+		std::vector<std::string_view> stop_names_;
+		std::vector<geo::Coordinates> stop_coordinates_;
+		// buses through a stop s are [stop_bus_offsets_[s], stop_bus_offsets_[s + 1]) of stop_buses_, filled by Freeze
+		std::vector<size_t> stop_bus_offsets_;
+		std::vector<BusId> stop_buses_;
+		NameIndex stop_ids_;
+		StopIndex stop_index_; // made by Freeze
+
+		// bus columns, the route of a bus is [route_offsets_[id], route_offsets_[id + 1]) of route_stops_
+		std::vector<std::string_view> bus_names_;
+		std::vector<size_t> route_offsets_{ 0 };
+		std::vector<StopId> route_stops_;
+		std::vector<bool> bus_roundtrips_;
+		std::vector<BusInfo> bus_infos_; // filled by Freeze
+		NameIndex bus_ids_;
 
-		std::deque<Stop> all_stops_;
-		std::unordered_map<std::string_view, Stop*> stops_catalogue_;
-		std::deque<Bus> all_buses_;
-		std::unordered_map<std::string_view, Bus*> buses_catalogue_;
-		std::unordered_map<std::string_view, std::set<std::string_view>> stops_to_buses_;
-		std::unordered_map<std::pair<Stop*, Stop*>, int, Hasher> distances_;
+		DistanceTable distances_;
+		bool is_frozen_ = false;
 
+		void CheckNotFrozen() const;
 
-		int CountUniqueStops(std::string_view bus) const;
+		// throws std::out_of_range for an unknown stop
+		StopId GetStopId(std::string_view stop_name) const;
+
+		// stop_marks must have an element per stop, none of them equal to the bus id
+		BusInfo ComputeBusInfo(BusId id, std::vector<BusId>& stop_marks) const;
+
+	};
+
+	// frozen catalogue shared by the readers. Get and Publish may be called from any threads without locks:
+	// a newer snapshot can be published while the readers of the previous one finish, which stays alive
+	// until they release it
+	class SnapshotHolder {
+	public:
+		using Snapshot = std::shared_ptr<const TransportCatalogue>;
+
+		// freezes the catalogue and makes it the current snapshot
+		void Publish(TransportCatalogue&& catalogue);
+
+		// nullptr until a catalogue is published
+		Snapshot Get() const;
+
+	private:
+		std::atomic<Snapshot> snapshot_;
 	};
 
 }
\ No newline at end of file
@@ -3,17 +3,36 @@
 #include "transport_router.h"
 #include "graph.h"
 
+#include <filesystem>
+#include <system_error>
+
 const double SPEED_COEF = 1000.0 / 60; //from km/hour to m/min
 
 void TransportRouter::BuildGraph(const transport_catalogue::TransportCatalogue& catalogue) {
-    auto sorted_stops = catalogue.GetSortedStops();
-    auto sorted_buses = catalogue.GetSortedBuses();
+    response_cache_.Clear();
+    line_graph_.reset();
+    removed_edge_count_ = 0;
+    route_table_size_ = 0;
+    stop_ids_ = {};
+    stop_names_.clear();
+    bus_names_.clear();
+    if (router_type_ == RouterType::ALL_PAIRS && !route_file_path_.empty()
+        && (compact_route_table_ ? LoadAllPairsRouter<float>(catalogue) : LoadAllPairsRouter<double>(catalogue))) {
+        return;
+    }
+
+    const auto sorted_stops = catalogue.GetSortedStops();
+    const auto sorted_buses = catalogue.GetBusCatalogue();
     graph::VertexId vertex_id = 0;
-    graph_ = graph::DirectedWeightedGraph<double>(sorted_stops.size() * 2);
-    for (const auto& [stop_name, stop_info] : sorted_stops) {
-        stop_ids_.emplace(std::make_pair(stop_name, vertex_id));
-        graph_.AddEdge({
-                                    stop_info->name,
+    std::vector<graph::Edge<double>> edges;
+    // arrival vertices by the stop id, so that the edges of a route need no name lookups
+    std::vector<graph::VertexId> stop_vertices(sorted_stops.size());
+    for (const transport_catalogue::Stop& stop : sorted_stops) {
+        stop_ids_.Add(stop.name, vertex_id);
+        stop_names_.push_back(stop.name);
+        stop_vertices[stop.id] = vertex_id;
+        edges.push_back({
+                                    static_cast<uint32_t>(stop_names_.size() - 1),
                                     0,
                                     vertex_id,
                                     ++vertex_id,
@@ -21,86 +40,355 @@ void TransportRouter::BuildGraph(const transport_catalogue::TransportCatalogue&
             });
         ++vertex_id;
     }
-    {
-        for (const auto& [bus_name, bus] : sorted_buses) {
-            const auto& bus_stops = bus->route;
-            size_t stops_count = bus_stops.size();
-            if (bus->is_roundtrip) {
-                for (size_t i = 0; i < stops_count; ++i) {
-                    for (size_t j = i + 1; j < stops_count; ++j) {
-                        const transport_catalogue::Stop* stop_from = bus_stops[i];
-                        const transport_catalogue::Stop* stop_to = bus_stops[j];
-                        if (i == 0 && j == stops_count - 1) {
-                            continue;
-                        }
-                        double dist_sum = 0.0;
-
-                        for (size_t k = i + 1; k <= j; ++k) {
-                            dist_sum += catalogue.GetDistance(bus_stops[k - 1]->name, bus_stops[k]->name);
-                        }
-                        graph_.AddEdge({
-                                                    bus->route_name,
-                                                    j - i,
-                                                    stop_ids_.at(stop_from->name) + 1,
-                                                    stop_ids_.at(stop_to->name),
-                                                    dist_sum / (bus_velocity_ * SPEED_COEF)
-                            });
-                    }
+    stop_ids_.Freeze();
+
+    // every bus has its own range of edge ids, in the order of bus names;
+    // router threads fill the ranges, so the ids do not depend on the threads
+    std::vector<const transport_catalogue::Bus*> buses;
+    std::vector<graph::EdgeId> bus_first_edges;
+    buses.reserve(sorted_buses.size());
+    bus_first_edges.reserve(sorted_buses.size() + 1);
+    bus_first_edges.push_back(edges.size());
+    std::vector<graph::LineGraph<double>::Line> lines;
+    for (const transport_catalogue::Bus& bus : sorted_buses) {
+        bus_names_.push_back(bus.route_name);
+        if (router_type_ == RouterType::IMPLICIT_DIJKSTRA) {
+            // the ride edges are generated from the lines during the search
+            AddBusLines(bus, static_cast<uint32_t>(bus_names_.size() - 1), stop_vertices, catalogue, lines);
+            continue;
+        }
+        size_t edge_count = 0;
+        ForEachRideEdge(bus, [&edge_count](size_t, size_t) { ++edge_count; });
+        buses.push_back(&bus);
+        bus_first_edges.push_back(bus_first_edges.back() + edge_count);
+    }
+    edges.resize(bus_first_edges.back());
+
+    std::atomic<size_t> next_bus = 0;
+    const auto make_edges = [&]() {
+        for (size_t i = next_bus++; i < buses.size(); i = next_bus++) {
+            MakeBusEdges(*buses[i], static_cast<uint32_t>(i), stop_vertices, catalogue, edges.begin() + bus_first_edges[i]);
+        }
+    };
+    const size_t thread_count = std::max<size_t>(1, std::min(thread_count_, buses.size()));
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(make_edges);
+    }
+    make_edges();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    graph_ = graph::DirectedWeightedGraph<double>(sorted_stops.size() * 2, std::move(edges));
+    if (remove_dominated_edges_) {
+        removed_edge_count_ = graph_.RemoveDominatedEdges();
+    }
+    graph_.Freeze();
+
+    switch (router_type_) {
+    case RouterType::ALL_PAIRS:
+        if (compact_route_table_) {
+            BuildAllPairsRouter<float>();
+        }
+        else {
+            BuildAllPairsRouter<double>();
+        }
+        break;
+    case RouterType::DIJKSTRA:
+        router_ = std::make_unique<graph::DijkstraRouter<double>>(graph_, route_cache_size_);
+        break;
+    case RouterType::CONTRACTION_HIERARCHIES:
+        router_ = std::make_unique<graph::ContractionHierarchy<double>>(graph_);
+        break;
+    case RouterType::ASTAR:
+    case RouterType::BIDIRECTIONAL_ASTAR:
+        router_ = std::make_unique<graph::AStarRouter<double, GeoLowerBound>>(graph_, MakeGeoLowerBound(catalogue),
+            router_type_ == RouterType::BIDIRECTIONAL_ASTAR);
+        break;
+    case RouterType::IMPLICIT_DIJKSTRA:
+        line_graph_ = std::make_unique<graph::LineGraph<double>>(graph_, std::move(lines), bus_velocity_ * SPEED_COEF);
+        router_ = std::make_unique<graph::DijkstraRouter<double, graph::LineGraph<double>>>(*line_graph_, route_cache_size_);
+        break;
+    }
+    route_file_rows_.reset();
+    fallback_router_.reset();
+    route_file_.reset();
+}
+
+template <typename TableWeight>
+void TransportRouter::BuildAllPairsRouter() {
+    auto router = std::make_unique<graph::Router<double, TableWeight>>(graph_, thread_count_);
+    if (!route_file_path_.empty()) {
+        try {
+            route_file::SaveRoutes(route_file_path_, route_file_key_, graph_,
+                router->GetTableWeights(), sizeof(TableWeight), router->GetTablePrevEdges());
+        }
+        catch (const std::exception&) {
+            // the file is only a cache: this run answers from the table in memory, the next one builds it again
+        }
+    }
+    route_table_size_ = router->GetTableSize();
+    router_ = std::move(router);
+}
+
+template <typename TableWeight>
+bool TransportRouter::LoadAllPairsRouter(const transport_catalogue::TransportCatalogue& catalogue) {
+    auto routes = route_file::LoadRoutes(route_file_path_, route_file_key_, sizeof(TableWeight));
+    const auto sorted_stops = catalogue.GetSortedStops();
+    if (!routes || routes->graph.GetVertexCount() != sorted_stops.size() * 2) {
+        return false;
+    }
+    graph::VertexId vertex_id = 0;
+    for (const transport_catalogue::Stop& stop : sorted_stops) {
+        stop_ids_.Add(stop.name, vertex_id);
+        stop_names_.push_back(stop.name);
+        vertex_id += 2;
+    }
+    stop_ids_.Freeze();
+    for (const transport_catalogue::Bus& bus : catalogue.GetBusCatalogue()) {
+        bus_names_.push_back(bus.route_name);
+    }
+    // the checker takes the vertex count from the loaded graph, before it is moved out
+    route_file_rows_ = std::make_unique<route_file::TableRowChecker>(*routes, sizeof(TableWeight));
+    fallback_router_.reset();
+    graph_ = std::move(routes->graph);
+    graph_.Freeze();
+    auto router = std::make_unique<graph::Router<double, TableWeight>>(graph_,
+        static_cast<const TableWeight*>(routes->weights), routes->prev_edges);
+    route_table_size_ = router->GetTableSize();
+    router_ = std::move(router);
+    route_file_ = std::move(routes->file);
+    return true;
+}
+
+const graph::RouterBase<double>& TransportRouter::GetRouterFrom(graph::VertexId from) const {
+    if (!route_file_rows_ || route_file_rows_->CheckRow(from)) {
+        return *router_;
+    }
+    if (!fallback_router_) {
+        // the table is kept for its valid rows, the next run rebuilds the file
+        std::error_code error;
+        std::filesystem::remove(route_file_path_, error);
+        fallback_router_ = std::make_unique<graph::DijkstraRouter<double>>(graph_);
+    }
+    return *fallback_router_;
+}
+
+template <typename Callback>
+void TransportRouter::ForEachRideEdge(const transport_catalogue::Bus& bus, Callback callback) {
+    const size_t stops_count = bus.route.size();
+    if (bus.is_roundtrip) {
+        for (size_t i = 0; i < stops_count; ++i) {
+            for (size_t j = i + 1; j < stops_count; ++j) {
+                if (i == 0 && j == stops_count - 1) {
+                    continue;
                 }
+                callback(i, j);
             }
-            else {
-                size_t half_stops_count = stops_count / 2;
-                for (size_t i = 0; i < half_stops_count; ++i) {
-                    for (size_t j = i + 1; j <= half_stops_count; ++j) {
-                        const transport_catalogue::Stop* stop_from = bus_stops[i];
-                        const transport_catalogue::Stop* stop_to = bus_stops[j];
-                        double dist_sum = 0.0;
-
-                        for (size_t k = i + 1; k <= j; ++k) {
-                            dist_sum += catalogue.GetDistance(bus_stops[k - 1]->name, bus_stops[k]->name);
-                        }
-                        graph_.AddEdge({
-                                                    bus->route_name,
-                                                    j - i,
-                                                    stop_ids_.at(stop_from->name) + 1,
-                                                    stop_ids_.at(stop_to->name),
-                                                    dist_sum / (bus_velocity_ * SPEED_COEF)
-                            });
-                    }
-                }
+        }
+    }
+    else {
+        size_t half_stops_count = stops_count / 2;
+        for (size_t i = 0; i < half_stops_count; ++i) {
+            for (size_t j = i + 1; j <= half_stops_count; ++j) {
+                callback(i, j);
+            }
+        }
+        for (size_t i = half_stops_count; i < stops_count; ++i) {
+            for (size_t j = i + 1; j < stops_count; ++j) {
+                callback(i, j);
+            }
+        }
+    }
+}
 
-                for (size_t i = half_stops_count; i < stops_count; ++i) {
-                    for (size_t j = i + 1; j < stops_count; ++j) {
-                        const transport_catalogue::Stop* stop_from = bus_stops[i];
-                        const transport_catalogue::Stop* stop_to = bus_stops[j];
-                        double dist_sum = 0.0;
-
-                        for (size_t k = i + 1; k <= j; ++k) {
-                            dist_sum += catalogue.GetDistance(bus_stops[k - 1]->name, bus_stops[k]->name);
-                        }
-                        graph_.AddEdge({
-                                                    bus->route_name,
-                                                    j - i,
-                                                    stop_ids_.at(stop_from->name) + 1,
-                                                    stop_ids_.at(stop_to->name),
-                                                    dist_sum / (bus_velocity_ * SPEED_COEF)
-                            });
-                    }
-                }
+void TransportRouter::MakeBusEdges(const transport_catalogue::Bus& bus, uint32_t bus_name_id,
+    const std::vector<graph::VertexId>& stop_vertices,
+    const transport_catalogue::TransportCatalogue& catalogue, std::vector<graph::Edge<double>>::iterator output) const {
+    std::vector<graph::VertexId> route_vertices;
+    route_vertices.reserve(bus.route.size());
+    for (const transport_catalogue::StopId stop : bus.route) {
+        route_vertices.push_back(stop_vertices[stop]);
+    }
+    const std::vector<int64_t> route_distances = ComputeRouteDistances(bus, catalogue);
 
+    // the sums of integer distances are exact, so the weights are the same as added segment by segment
+    ForEachRideEdge(bus, [&](size_t i, size_t j) {
+        *output++ = {
+                        bus_name_id,
+                        j - i,
+                        route_vertices[i] + 1,
+                        route_vertices[j],
+                        static_cast<double>(route_distances[j] - route_distances[i]) / (bus_velocity_ * SPEED_COEF)
+            };
+    });
+}
+
+void TransportRouter::AddBusLines(const transport_catalogue::Bus& bus, uint32_t bus_name_id,
+    const std::vector<graph::VertexId>& stop_vertices,
+    const transport_catalogue::TransportCatalogue& catalogue, std::vector<graph::LineGraph<double>::Line>& lines) const {
+    const std::vector<int64_t> route_distances = ComputeRouteDistances(bus, catalogue);
+    const auto add_line = [&](size_t first, size_t last) {
+        graph::LineGraph<double>::Line line{ bus_name_id, {} };
+        line.stops.reserve(last - first + 1);
+        for (size_t k = first; k <= last; ++k) {
+            const graph::VertexId vertex = stop_vertices[bus.route[k]];
+            line.stops.push_back({ vertex + 1, vertex, route_distances[k] - route_distances[first] });
+        }
+        lines.push_back(std::move(line));
+    };
+    if (bus.route.empty()) {
+        return;
+    }
+    // the same sections as in ForEachRideEdge. The edge from the first stop of a round trip to the last one
+    // joins the departure of a stop to its own arrival, so it never shortens a route and is not left out here
+    if (bus.is_roundtrip) {
+        add_line(0, bus.route.size() - 1);
+    }
+    else {
+        const size_t half_stops_count = bus.route.size() / 2;
+        add_line(0, half_stops_count);
+        add_line(half_stops_count, bus.route.size() - 1);
+    }
+}
+
+std::vector<int64_t> TransportRouter::ComputeRouteDistances(const transport_catalogue::Bus& bus,
+    const transport_catalogue::TransportCatalogue& catalogue) {
+    std::vector<int64_t> route_distances{ 0 };
+    route_distances.reserve(bus.route.size());
+    for (size_t k = 1; k < bus.route.size(); ++k) {
+        route_distances.push_back(route_distances.back() + catalogue.GetDistance(bus.route[k - 1], bus.route[k]));
+    }
+    return route_distances;
+}
+
+TransportRouter::GeoLowerBound TransportRouter::MakeGeoLowerBound(const transport_catalogue::TransportCatalogue& catalogue) const {
+    GeoLowerBound lower_bound{ {}, 0.0, bus_wait_time_ };
+    for (const transport_catalogue::Stop& stop : catalogue.GetSortedStops()) {
+        lower_bound.stop_coordinates.push_back(stop.coordinates);
+    }
+
+    // road distances may be shorter than the great-circle ones, so the speed alone does not bound the time
+    double road_per_geo_meter = std::numeric_limits<double>::infinity();
+    for (transport_catalogue::BusId bus_id = 0; bus_id < catalogue.GetBusCount(); ++bus_id) {
+        const transport_catalogue::Bus bus = catalogue.GetBus(bus_id);
+        for (size_t i = 1; i < bus.route.size(); ++i) {
+            const double geo_distance = geo::ComputeHaversineDistance(catalogue.GetStop(bus.route[i - 1]).coordinates,
+                catalogue.GetStop(bus.route[i]).coordinates);
+            if (geo_distance > 0.0) {
+                road_per_geo_meter = std::min(road_per_geo_meter,
+                    catalogue.GetDistance(bus.route[i - 1], bus.route[i]) / geo_distance);
             }
         }
     }
-    router_ = std::make_unique<graph::Router<double>>(graph_);
+    if (road_per_geo_meter != std::numeric_limits<double>::infinity()) {
+        // a little below the exact value, so that rounding never makes the bound exceed a route time
+        lower_bound.time_per_meter = road_per_geo_meter / (bus_velocity_ * SPEED_COEF) * (1.0 - 1e-9);
+    }
+    return lower_bound;
 }
 
-const std::optional<graph::Router<double>::RouteInfo> TransportRouter::FindRoute(const std::string_view from, const std::string_view to) const {
-    if (!stop_ids_.count(std::string(from)) || !stop_ids_.count(std::string(to))) {
+const std::optional<graph::RouterBase<double>::RouteInfo> TransportRouter::FindRoute(const std::string_view from, const std::string_view to) const {
+    const std::optional<graph::VertexId> from_vertex = stop_ids_.Find(from);
+    const std::optional<graph::VertexId> to_vertex = stop_ids_.Find(to);
+    if (!from_vertex || !to_vertex) {
         return std::nullopt;
     }
-    return router_->BuildRoute(stop_ids_.at(std::string(from)), stop_ids_.at(std::string(to)));
+    return GetRouterFrom(*from_vertex).BuildRoute(*from_vertex, *to_vertex);
+}
+
+std::optional<graph::WeightMatrixBuilder<double>::Matrix> TransportRouter::FindTimeMatrix(
+    const std::vector<std::string_view>& from, const std::vector<std::string_view>& to) const {
+    const auto find_vertices = [this](const std::vector<std::string_view>& stops, std::vector<graph::VertexId>& vertices) {
+        vertices.reserve(stops.size());
+        for (const std::string_view stop : stops) {
+            const std::optional<graph::VertexId> vertex = stop_ids_.Find(stop);
+            if (!vertex) {
+                return false;
+            }
+            vertices.push_back(*vertex);
+        }
+        return true;
+    };
+    std::vector<graph::VertexId> sources;
+    std::vector<graph::VertexId> targets;
+    if (!find_vertices(from, sources) || !find_vertices(to, targets)) {
+        return std::nullopt;
+    }
+
+    if (line_graph_) {
+        return graph::WeightMatrixBuilder<double, graph::LineGraph<double>>(*line_graph_).Build(sources, targets, thread_count_);
+    }
+    if (router_type_ != RouterType::ALL_PAIRS) {
+        return graph::WeightMatrixBuilder<double>(graph_).Build(sources, targets, thread_count_);
+    }
+    graph::WeightMatrixBuilder<double>::Matrix matrix(sources.size(), std::vector<std::optional<double>>(targets.size()));
+    for (size_t row = 0; row < sources.size(); ++row) {
+        const graph::RouterBase<double>& router = GetRouterFrom(sources[row]);
+        for (size_t column = 0; column < targets.size(); ++column) {
+            matrix[row][column] = router.GetRouteWeight(sources[row], targets[column]);
+        }
+    }
+    return matrix;
+}
+
+std::optional<std::vector<std::pair<std::string_view, double>>> TransportRouter::FindReachableStops(
+    const std::string_view from, double max_time) const {
+    const std::optional<graph::VertexId> from_vertex = stop_ids_.Find(from);
+    if (!from_vertex) {
+        return std::nullopt;
+    }
+    std::vector<std::pair<std::string_view, double>> stops;
+    const auto reachable = line_graph_ ? graph::FindReachableVertices(*line_graph_, *from_vertex, max_time)
+        : graph::FindReachableVertices(graph_, *from_vertex, max_time);
+    for (const auto& [vertex, time] : reachable) {
+        // a stop is reached at its arrival vertex, the boarding ones only lead further
+        if (vertex % 2 == 0) {
+            stops.emplace_back(stop_names_[vertex / 2], time);
+        }
+    }
+    return stops;
 }
 
 const graph::DirectedWeightedGraph<double>& TransportRouter::GetGraph() const {
     return graph_;
+}
+
+graph::Edge<double> TransportRouter::GetEdge(graph::EdgeId edge_id) const {
+    return line_graph_ ? line_graph_->GetEdge(edge_id) : graph_.GetEdge(edge_id);
+}
+
+std::string_view TransportRouter::GetEdgeName(const graph::Edge<double>& edge) const {
+    return edge.span_count == 0 ? stop_names_.at(edge.name_id) : bus_names_.at(edge.name_id);
+}
+
+std::optional<uint64_t> TransportRouter::GetStopPairKey(const std::string_view from, const std::string_view to) const {
+    const std::optional<graph::VertexId> from_vertex = stop_ids_.Find(from);
+    const std::optional<graph::VertexId> to_vertex = stop_ids_.Find(to);
+    if (!from_vertex || !to_vertex) {
+        return std::nullopt;
+    }
+    return static_cast<uint64_t>(*from_vertex / 2) << 32 | static_cast<uint64_t>(*to_vertex / 2);
+}
+
+TransportRouter::RouteResponse TransportRouter::FindRouteResponse(const std::string_view from, const std::string_view to) const {
+    if (response_cache_.GetCapacity() == 0) {
+        return nullptr;
+    }
+    const auto key = GetStopPairKey(from, to);
+    if (!key) {
+        return nullptr;
+    }
+    return response_cache_.Find(*key).value_or(nullptr);
+}
+
+void TransportRouter::AddRouteResponse(const std::string_view from, const std::string_view to, RouteResponse response) const {
+    if (const auto key = GetStopPairKey(from, to); key && response_cache_.GetCapacity() > 0) {
+        response_cache_.Insert(*key, std::move(response));
+    }
+}
+
+size_t TransportRouter::GetSettledVertexCount() const {
+    return router_->GetSettledVertexCount();
 }
\ No newline at end of file
@@ -1,12 +1,37 @@
 ﻿#pragma once
 
+#include "astar_router.h"
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
+#include "geo.h"
 #include "graph.h"
+#include "json.h"
+#include "line_graph.h"
+#include "lru_cache.h"
+#include "reachability.h"
+#include "route_file.h"
 #include "router.h"
 #include "transport_catalogue.h"
+#include "weight_matrix.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <iostream>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class RouterType {
+    ALL_PAIRS, // Floyd-Warshall table built once, fast queries, O(V^2) memory
+    DIJKSTRA,  // search per query, nothing is precomputed
+    CONTRACTION_HIERARCHIES, // shortcuts built once, bidirectional search over few vertices per query
+    ASTAR,     // search per query directed to the target by the distance between the stops
+    BIDIRECTIONAL_ASTAR, // the same search from both ends
+    IMPLICIT_DIJKSTRA, // search per query, the ride edges are generated from the bus routes instead of being stored
+};
 
 class TransportRouter {
 public:
@@ -20,15 +45,156 @@ public:
         bus_wait_time_ = time;
         return *this;
     }
+    TransportRouter& SetRouterType(RouterType type) {
+        router_type_ = type;
+        return *this;
+    }
+    // number of threads that make the graph edges and build the all-pairs table
+    TransportRouter& SetThreadCount(size_t count) {
+        thread_count_ = count;
+        return *this;
+    }
+    // keeps the all-pairs table weights in float: 8 bytes per stop pair instead of 12,
+    // route times may differ from the exact ones in the last digits
+    TransportRouter& SetCompactRouteTable(bool compact) {
+        compact_route_table_ = compact;
+        return *this;
+    }
+    // file that keeps the graph and the all-pairs table between runs, key identifies the input they were built for.
+    // A file with another key or a damaged one is rebuilt, a file that cannot be written only costs the next run the build
+    TransportRouter& SetRouteFile(std::string path, uint64_t key) {
+        route_file_path_ = std::move(path);
+        route_file_key_ = key;
+        return *this;
+    }
+    // number of Route responses kept by the response cache, 0 disables it
+    TransportRouter& SetResponseCacheSize(size_t capacity, size_t shard_count = 16) {
+        response_cache_.Reset(capacity, shard_count);
+        return *this;
+    }
+    // removes the ride edges that a parallel edge is at least as fast as, before the router is built
+    TransportRouter& SetRemoveDominatedEdges(bool remove) {
+        remove_dominated_edges_ = remove;
+        return *this;
+    }
+    // number of shortest-path trees kept by the Dijkstra router, 0 disables the cache
+    TransportRouter& SetRouteCacheSize(size_t size) {
+        route_cache_size_ = size;
+        return *this;
+    }
 
     void BuildGraph(const transport_catalogue::TransportCatalogue& catalogue);
-    const std::optional<graph::Router<double>::RouteInfo> FindRoute(const std::string_view from, const std::string_view to) const;
+    const std::optional<graph::RouterBase<double>::RouteInfo> FindRoute(const std::string_view from, const std::string_view to) const;
+    // travel times from every stop of "from" to every stop of "to", std::nullopt if a stop is unknown.
+    // The all-pairs table is read directly, other routers are replaced by one search per source stop,
+    // spread over the router threads
+    std::optional<graph::WeightMatrixBuilder<double>::Matrix> FindTimeMatrix(const std::vector<std::string_view>& from,
+        const std::vector<std::string_view>& to) const;
+    // stops that can be reached from "from" within max_time with the earliest arrival times, by growing time
+    // starting with "from" itself; std::nullopt if the stop is unknown
+    std::optional<std::vector<std::pair<std::string_view, double>>> FindReachableStops(const std::string_view from,
+        double max_time) const;
+    // the stored edges only, the ride edges of IMPLICIT_DIJKSTRA are in none of them
     const graph::DirectedWeightedGraph<double>& GetGraph() const;
+    // edge of a route found by FindRoute, for any router type
+    graph::Edge<double> GetEdge(graph::EdgeId edge_id) const;
+    // stop name of a wait edge, bus name of a ride edge
+    std::string_view GetEdgeName(const graph::Edge<double>& edge) const;
+
+    // Route responses built by the reader (items and total_time) for a pair of stops, dropped by BuildGraph.
+    // Pairs of unknown stops are never kept
+    using RouteResponse = std::shared_ptr<const json::Dict>;
+    RouteResponse FindRouteResponse(const std::string_view from, const std::string_view to) const;
+    void AddRouteResponse(const std::string_view from, const std::string_view to, RouteResponse response) const;
+    // vertices settled by the last FindRoute call, 0 for the all-pairs table and for cached routes
+    size_t GetSettledVertexCount() const;
+    // edges removed by the last BuildGraph, 0 if the graph was taken from the route file
+    size_t GetRemovedEdgeCount() const {
+        return removed_edge_count_;
+    }
+    // bytes of the all-pairs table, built or mapped from the route file; 0 for the other routers
+    size_t GetRouteTableSize() const {
+        return route_table_size_;
+    }
+    CacheStats GetResponseCacheStats() const {
+        return response_cache_.GetStats();
+    }
 private:
+    // the pair of stop ids in one number
+    std::optional<uint64_t> GetStopPairKey(const std::string_view from, const std::string_view to) const;
+
+    // spreads the packed stop pairs over the cache shards
+    struct StopPairHasher {
+        size_t operator()(uint64_t key) const {
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32);
+        }
+    };
+
+    // lower bound of the travel time between two vertices for the A* routers: the great-circle distance
+    // between their stops at the least time per meter seen on the route segments, plus the wait
+    // that every route leaving an arrival vertex starts with
+    struct GeoLowerBound {
+        std::vector<geo::Coordinates> stop_coordinates; // by the vertex id / 2
+        double time_per_meter;
+        double wait_time;
+
+        double operator()(graph::VertexId from, graph::VertexId to) const {
+            if (from == to) {
+                return 0.0;
+            }
+            const double distance = geo::ComputeHaversineDistance(stop_coordinates[from / 2], stop_coordinates[to / 2]);
+            return distance * time_per_meter + (from % 2 == 0 ? wait_time : 0.0);
+        }
+    };
+
+    GeoLowerBound MakeGeoLowerBound(const transport_catalogue::TransportCatalogue& catalogue) const;
+
+    // calls callback(i, j) for the route stops i and j joined by a ride edge, in the order of the edge ids
+    template <typename Callback>
+    static void ForEachRideEdge(const transport_catalogue::Bus& bus, Callback callback);
+
+    // writes the ride edges of the bus starting from output
+    void MakeBusEdges(const transport_catalogue::Bus& bus, uint32_t bus_name_id,
+        const std::vector<graph::VertexId>& stop_vertices,
+        const transport_catalogue::TransportCatalogue& catalogue, std::vector<graph::Edge<double>>::iterator output) const;
+    // adds the sections of the bus route, as LineGraph lines of its ride edges
+    void AddBusLines(const transport_catalogue::Bus& bus, uint32_t bus_name_id,
+        const std::vector<graph::VertexId>& stop_vertices,
+        const transport_catalogue::TransportCatalogue& catalogue, std::vector<graph::LineGraph<double>::Line>& lines) const;
+    // road distances from the first stop of the route to every stop of it
+    static std::vector<int64_t> ComputeRouteDistances(const transport_catalogue::Bus& bus,
+        const transport_catalogue::TransportCatalogue& catalogue);
+
+    // builds the all-pairs router and saves it to the route file if there is one
+    template <typename TableWeight>
+    void BuildAllPairsRouter();
+    // takes the graph and the all-pairs table from the route file, false if it cannot be used
+    template <typename TableWeight>
+    bool LoadAllPairsRouter(const transport_catalogue::TransportCatalogue& catalogue);
+    // the router for the routes from the vertex: router_, or a Dijkstra one over the same graph
+    // if the row of the vertex in the route file table is damaged
+    const graph::RouterBase<double>& GetRouterFrom(graph::VertexId from) const;
+
     double bus_velocity_ = 0.0;
     double bus_wait_time_ = 0;
+    RouterType router_type_ = RouterType::ALL_PAIRS;
+    size_t route_cache_size_ = 0;
+    size_t thread_count_ = 1;
+    bool compact_route_table_ = false;
+    bool remove_dominated_edges_ = false;
+    size_t removed_edge_count_ = 0;
+    size_t route_table_size_ = 0;
+    std::string route_file_path_;
+    uint64_t route_file_key_ = 0;
 
     graph::DirectedWeightedGraph<double> graph_;
-    std::unordered_map<std::string_view, graph::VertexId> stop_ids_;
-    std::unique_ptr<graph::Router<double>> router_;
+    transport_catalogue::NameIndex stop_ids_; // arrival vertices by the stop name
+    std::vector<std::string_view> stop_names_; // by the vertex id / 2, names of the wait edges
+    std::vector<std::string_view> bus_names_;  // in the name order, names of the ride edges
+    mutable ShardedLruCache<uint64_t, RouteResponse, StopPairHasher> response_cache_;
+    std::unique_ptr<route_file::MappedFile> route_file_; // declared before the router that reads it
+    std::unique_ptr<route_file::TableRowChecker> route_file_rows_;
+    mutable std::unique_ptr<graph::RouterBase<double>> fallback_router_; // made at the first damaged row
+    std::unique_ptr<graph::LineGraph<double>> line_graph_; // IMPLICIT_DIJKSTRA only
+    std::unique_ptr<graph::RouterBase<double>> router_;
 };
\ No newline at end of file
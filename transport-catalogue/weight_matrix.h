@@ -0,0 +1,162 @@
+﻿#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace graph {
+
+    // weights of the shortest routes from every source to every target, std::nullopt where there is no route.
+    // Runs one Dijkstra search per source that stops once all the targets are settled.
+    // Sources are taken by thread_count threads, each with its own search buffers. The graph has to be frozen.
+    // Graph may also be a LineGraph
+    template <typename Weight, typename Graph = DirectedWeightedGraph<Weight>>
+    class WeightMatrixBuilder {
+    public:
+        using Matrix = std::vector<std::vector<std::optional<Weight>>>;
+
+        explicit WeightMatrixBuilder(const Graph& graph);
+
+        Matrix Build(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets,
+            size_t thread_count = 1) const;
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+            ? std::numeric_limits<Weight>::infinity()
+            : std::numeric_limits<Weight>::max();
+
+        struct QueueItem {
+            Weight weight;
+            VertexId vertex;
+
+            bool operator>(const QueueItem& other) const {
+                return weight > other.weight || (weight == other.weight && vertex > other.vertex);
+            }
+        };
+
+        // buffers of one thread, reset through the list of touched vertices
+        struct Search {
+            std::vector<Weight> weights;
+            std::vector<bool> settled;
+            std::vector<VertexId> touched_vertices;
+            std::vector<QueueItem> queue;
+
+            explicit Search(size_t vertex_count)
+                : weights(vertex_count, INFINITE_WEIGHT)
+                , settled(vertex_count, false) {
+            }
+        };
+
+        // fills the weights of the search, target_count is the number of distinct marked targets
+        void RunSearch(Search& search, VertexId from, const std::vector<bool>& is_target, size_t target_count) const;
+
+        const Graph& graph_;
+    };
+
+    template <typename Weight, typename Graph>
+    WeightMatrixBuilder<Weight, Graph>::WeightMatrixBuilder(const Graph& graph)
+        : graph_(graph)
+    {
+        if (graph.HasNegativeWeights()) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    template <typename Weight, typename Graph>
+    void WeightMatrixBuilder<Weight, Graph>::RunSearch(Search& search, VertexId from, const std::vector<bool>& is_target,
+        size_t target_count) const {
+        for (const VertexId vertex : search.touched_vertices) {
+            search.weights[vertex] = INFINITE_WEIGHT;
+            search.settled[vertex] = false;
+        }
+        search.touched_vertices.clear();
+        search.queue.clear();
+
+        const auto greater = [](const QueueItem& lhs, const QueueItem& rhs) { return lhs > rhs; };
+        search.weights[from] = ZERO_WEIGHT;
+        search.touched_vertices.push_back(from);
+        search.queue.push_back({ ZERO_WEIGHT, from });
+
+        while (!search.queue.empty() && target_count > 0) {
+            std::pop_heap(search.queue.begin(), search.queue.end(), greater);
+            const QueueItem item = search.queue.back();
+            search.queue.pop_back();
+            if (search.settled[item.vertex]) {
+                continue; // outdated queue entry
+            }
+            search.settled[item.vertex] = true;
+            if (is_target[item.vertex]) {
+                --target_count;
+            }
+
+            graph_.ForEachOutgoingEdge(item.vertex, [&](VertexId next, Weight edge_weight, EdgeId) {
+                const Weight candidate_weight = item.weight + edge_weight;
+                Weight& weight = search.weights[next];
+                if (candidate_weight < weight) {
+                    if (weight == INFINITE_WEIGHT) {
+                        search.touched_vertices.push_back(next);
+                    }
+                    weight = candidate_weight;
+                    search.queue.push_back({ candidate_weight, next });
+                    std::push_heap(search.queue.begin(), search.queue.end(), greater);
+                }
+            });
+        }
+    }
+
+    template <typename Weight, typename Graph>
+    typename WeightMatrixBuilder<Weight, Graph>::Matrix WeightMatrixBuilder<Weight, Graph>::Build(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets, size_t thread_count) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        std::vector<bool> is_target(vertex_count, false);
+        size_t target_count = 0;
+        for (const VertexId target : targets) {
+            if (target >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            if (!is_target[target]) {
+                is_target[target] = true;
+                ++target_count;
+            }
+        }
+        for (const VertexId source : sources) {
+            if (source >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+        }
+
+        Matrix matrix(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+        std::atomic<size_t> next_source = 0;
+        const auto fill_rows = [&]() {
+            Search search(vertex_count);
+            for (size_t row = next_source++; row < sources.size(); row = next_source++) {
+                RunSearch(search, sources[row], is_target, target_count);
+                for (size_t column = 0; column < targets.size(); ++column) {
+                    if (search.settled[targets[column]]) {
+                        matrix[row][column] = search.weights[targets[column]];
+                    }
+                }
+            }
+        };
+
+        thread_count = std::max<size_t>(1, std::min(thread_count, sources.size()));
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t i = 1; i < thread_count; ++i) {
+            threads.emplace_back(fill_rows);
+        }
+        fill_rows();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        return matrix;
+    }
+
+}  // namespace graph